@@ -0,0 +1,349 @@
+#include "Batch.h"
+#include "Parallel.h"
+#include "TemplateWriter.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+static const char* const batch_columns[5] = {"circumference1", "circumference2", "height", "cut_angle", "outputfile"};
+
+static std::string Trim(const std::string& s)
+{
+    size_t a = s.find_first_not_of(" \t\r\n"), b = s.find_last_not_of(" \t\r\n");
+    return a == std::string::npos ? std::string() : s.substr(a, b - a + 1);
+}
+
+static bool ParseNumber(const std::string& s, double& v)
+{
+    char* end;
+    v = strtod(s.c_str(), &end);
+    return !s.empty() && *end == 0;
+}
+
+// value of column k ("outputfile" is text, the others numbers); error keeps the first problem
+static void SetField(TemplateJob& job, int k, const std::string& value, std::string& error)
+{
+    if (k == 4)
+    {
+        job.outputfile = value;
+        return;
+    }
+    double v;
+    if (!ParseNumber(value, v))
+    {
+        if (error.empty())
+            error = std::string("bad ") + batch_columns[k] + ": '" + value + "'";
+        return;
+    }
+    double* fields[4] = {&job.circumference1, &job.circumference2, &job.height, &job.cut_angle};
+    *fields[k] = v;
+}
+
+static int ColumnIndex(const std::string& name)
+{
+    for (int k = 0; k < 5; k++)
+        if (name == batch_columns[k])
+            return k;
+    return -1;
+}
+
+static std::vector<std::string> SplitCsv(const std::string& line)
+{
+    // fields may be quoted, with "" for a quote inside
+    std::vector<std::string> fields(1);
+    bool quoted = false;
+    for (size_t i = 0; i < line.size(); i++)
+    {
+        char c = line[i];
+        if (quoted && c == '"' && i + 1 < line.size() && line[i + 1] == '"')
+            fields.back() += line[++i];
+        else if (c == '"')
+            quoted = !quoted;
+        else if (c == ',' && !quoted)
+            fields.emplace_back();
+        else
+            fields.back() += c;
+    }
+    for (std::string& f : fields)
+        f = Trim(f);
+    return fields;
+}
+
+// a flat JSON object of numbers and strings; throws std::runtime_error if malformed
+static void ParseJsonObject(const std::string& line, TemplateJob& job, std::string& error, bool seen[5])
+{
+    size_t i = 0;
+    auto skip = [&]
+    {
+        while (i < line.size() && isspace((unsigned char)line[i]))
+            i++;
+    };
+    auto expect = [&](char c)
+    {
+        skip();
+        if (i >= line.size() || line[i] != c)
+            throw std::runtime_error(std::string("expected '") + c + "' at column " + std::to_string(i + 1));
+        i++;
+    };
+    auto read_string = [&]
+    {
+        expect('"');
+        std::string s;
+        while (i < line.size() && line[i] != '"')
+        {
+            char c = line[i++];
+            if (c == '\\' && i < line.size())
+            {
+                c = line[i++];
+                if (c == 'n')
+                    c = '\n';
+                else if (c == 't')
+                    c = '\t';
+                else if (c == 'u' && i + 4 <= line.size())
+                {
+                    c = (char)strtol(line.substr(i, 4).c_str(), nullptr, 16);
+                    i += 4;
+                }
+            }
+            s += c;
+        }
+        expect('"');
+        return s;
+    };
+
+    expect('{');
+    skip();
+    if (i < line.size() && line[i] == '}')
+        return;
+    for (;;)
+    {
+        std::string key = read_string();
+        expect(':');
+        skip();
+        std::string value;
+        bool text = i < line.size() && line[i] == '"';
+        if (text)
+            value = read_string();
+        else
+        {
+            size_t end = line.find_first_of(",}", i);
+            value = Trim(line.substr(i, end == std::string::npos ? std::string::npos : end - i));
+            i = end == std::string::npos ? line.size() : end;
+        }
+        int k = ColumnIndex(key);
+        if (k >= 0)
+        {
+            if ((k == 4) != text)
+                throw std::runtime_error(key + (k == 4 ? " must be a string" : " must be a number"));
+            SetField(job, k, value, error);
+            seen[k] = true;
+        }
+        skip();
+        if (i < line.size() && line[i] == ',')
+        {
+            i++;
+            continue;
+        }
+        expect('}');
+        skip();
+        if (i != line.size())
+            throw std::runtime_error("text after the object");
+        return;
+    }
+}
+
+std::vector<BatchItem> ReadBatch(std::istream& in)
+{
+    std::vector<BatchItem> items;
+    int columns[5] = {0, 1, 2, 3, 4}; // CSV field of each column
+    bool first_csv = true;
+    std::string line;
+    for (int number = 1; std::getline(in, line); number++)
+    {
+        line = Trim(line);
+        if (line.empty() || line[0] == '#')
+            continue;
+        BatchItem item;
+        item.line = number;
+        bool seen[5] = {};
+        if (line[0] == '{')
+        {
+            try
+            {
+                ParseJsonObject(line, item.job, item.error, seen);
+            }
+            catch (const std::runtime_error& e)
+            {
+                item.error = std::string("malformed JSON: ") + e.what();
+            }
+        }
+        else
+        {
+            std::vector<std::string> fields = SplitCsv(line);
+            // a first row naming any column is the header; otherwise it is data and a bad
+            // number in it is reported as such
+            bool header = false;
+            for (const std::string& f : fields)
+                header = header || (first_csv && ColumnIndex(f) >= 0);
+            if (header)
+            {
+                first_csv = false;
+                std::fill(columns, columns + 5, -1);
+                for (int f = 0; f < (int)fields.size(); f++)
+                    if (ColumnIndex(fields[f]) >= 0)
+                        columns[ColumnIndex(fields[f])] = f;
+                continue;
+            }
+            first_csv = false;
+            for (int k = 0; k < 5; k++)
+            {
+                if (columns[k] < 0 || columns[k] >= (int)fields.size())
+                    continue;
+                SetField(item.job, k, fields[columns[k]], item.error);
+                seen[k] = true;
+            }
+        }
+
+        for (int k = 0; k < 5 && item.error.empty(); k++)
+            if (!seen[k])
+                item.error = std::string("missing ") + batch_columns[k];
+        const TemplateJob& job = item.job;
+        if (item.error.empty() && !(job.circumference1 > 0 && job.circumference2 > 0 && job.height > 0 &&
+                                    std::isfinite(job.circumference1 + job.circumference2 + job.height + job.cut_angle)))
+            item.error = "circumferences and height must be positive";
+        if (item.error.empty() && job.outputfile.empty())
+            item.error = "empty outputfile";
+        items.push_back(item);
+    }
+    return items;
+}
+
+// The SVG or DXF output file whose page k > 1 goes to name (PageFilePath(base, k) == name), or
+// "" if name cannot be such a page
+static std::string PageBase(const std::string& name)
+{
+    if (!WritesPageFiles(name))
+        return std::string();
+    size_t dot = name.find_last_of('.');
+    size_t mark = name.find_last_of('_', dot);
+    if (mark == std::string::npos || dot - mark < 2 || dot - mark > 10 || name[mark + 1] == '0')
+        return std::string();
+    std::string digits = name.substr(mark + 1, dot - mark - 1);
+    if (digits.find_first_not_of("0123456789") != std::string::npos)
+        return std::string();
+    std::string base = name.substr(0, mark) + name.substr(dot);
+    int page = std::stoi(digits);
+    return page > 1 && PageFilePath(base, page) == name ? base : std::string();
+}
+
+std::vector<BatchResult> RunBatch(const std::vector<BatchItem>& items, int threads,
+                                  const std::function<bool(const TemplateJob&, std::ostream&)>& work)
+{
+    std::vector<BatchResult> results(items.size());
+    std::map<std::string, size_t> outputs; // outputfile -> first item writing it
+    for (size_t i = 0; i < items.size(); i++)
+    {
+        if (!items[i].error.empty())
+            results[i].message = items[i].error;
+        else if (!outputs.emplace(items[i].job.outputfile, i).second)
+            results[i].message = "outputfile already written by an earlier line";
+    }
+    // a tiled SVG or DXF template also writes its later pages next to outputfile; the later of
+    // two lines where one's page file is the other's outputfile fails
+    for (size_t i = 0; i < items.size(); i++)
+    {
+        if (!results[i].message.empty())
+            continue;
+        auto base = outputs.find(PageBase(items[i].job.outputfile));
+        if (base == outputs.end() || !results[base->second].message.empty())
+            continue;
+        if (base->second < i)
+            results[i].message = "outputfile is a page file of " + base->first + " from an earlier line";
+        else
+            results[base->second].message = "a page file would overwrite " + items[i].job.outputfile +
+                " from an earlier line";
+    }
+
+    threads = std::max(1, std::min(threads, (int)items.size()));
+    std::atomic<size_t> next{0};
+    auto worker = [&]
+    {
+        // with several workers the cores are already busy: each item runs its loops serially
+        const bool serial = parallel_serial;
+        parallel_serial = serial || threads > 1;
+        for (size_t i = next++; i < items.size(); i = next++)
+        {
+            if (!results[i].message.empty())
+                continue;
+            std::ostringstream log;
+            auto start = std::chrono::steady_clock::now();
+            try
+            {
+                results[i].ok = work(items[i].job, log);
+            }
+            catch (const std::exception& e)
+            {
+                log << "[ERROR] " << e.what() << '\n';
+            }
+            catch (...)
+            {
+                log << "[ERROR] unknown exception\n";
+            }
+            results[i].ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+            // keep the warnings and errors, one line each
+            std::istringstream lines(log.str());
+            std::string line;
+            while (std::getline(lines, line))
+            {
+                if (line.rfind("[WARNING]", 0) != 0 && line.rfind("[ERROR]", 0) != 0)
+                    continue;
+                if (!results[i].message.empty())
+                    results[i].message += "; ";
+                results[i].message += line;
+            }
+            if (!results[i].ok && results[i].message.empty())
+                results[i].message = "failed";
+        }
+        parallel_serial = serial;
+    };
+    std::vector<std::thread> pool;
+    for (int t = 1; t < threads; t++)
+        pool.emplace_back(worker);
+    worker();
+    for (std::thread& t : pool)
+        t.join();
+    return results;
+}
+
+static std::string CsvField(const std::string& s)
+{
+    if (s.find_first_of(",\"\n") == std::string::npos)
+        return s;
+    std::string quoted = "\"";
+    for (char c : s)
+        quoted += c == '"' ? std::string("\"\"") : std::string(1, c);
+    return quoted + "\"";
+}
+
+bool WriteManifest(const std::string& path, const std::vector<BatchItem>& items,
+                   const std::vector<BatchResult>& results)
+{
+    std::ofstream out(path);
+    if (!out)
+        return false;
+    out << "line,outputfile,status,ms,message\n";
+    for (size_t i = 0; i < items.size(); i++)
+    {
+        out << items[i].line << ',' << CsvField(items[i].job.outputfile) << ',' << (results[i].ok ? "ok" : "failed")
+            << ',' << results[i].ms << ',' << CsvField(results[i].message) << '\n';
+    }
+    return (bool)out;
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include <functional>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// One template in the CLI's units: circumferences and height in cm, cut angle in degrees
+struct TemplateJob
+{
+    double circumference1 = 0, circumference2 = 0, height = 0, cut_angle = 0;
+    std::string outputfile;
+};
+
+// A row of a batch file; rows that do not parse keep their error and are reported as failed
+struct BatchItem
+{
+    int line = 0;
+    TemplateJob job;
+    std::string error;
+};
+
+// Reads one template per line, as JSONL objects
+//     {"circumference1": 30, "circumference2": 20, "height": 10, "cut_angle": 45, "outputfile": "a.pdf"}
+// or as CSV rows "circumference1,circumference2,height,cut_angle,outputfile", optionally under a
+// header naming the columns in any order (a first row with at least one column name; any other
+// first row is data). Blank lines and lines starting with # are skipped.
+std::vector<BatchItem> ReadBatch(std::istream& in);
+
+struct BatchResult
+{
+    bool ok = false;
+    double ms = 0;
+    std::string message; // the item's [WARNING]/[ERROR] lines, or why it failed
+};
+
+// Runs work on every item that parsed, on a pool of threads taking items in order. work writes
+// its messages to the given stream and returns false if the item failed; an exception fails
+// only its own item. Items sharing an output file after the first are failed without running,
+// as is the later of two SVG or DXF items where one's outputfile is a page file of the other
+// (a.svg writes page 2 to a_2.svg if it is tiled, which is only known once it runs).
+// With more than one thread, work runs its ParallelFor loops serially (see parallel_serial).
+std::vector<BatchResult> RunBatch(const std::vector<BatchItem>& items, int threads,
+                                  const std::function<bool(const TemplateJob&, std::ostream&)>& work);
+
+// CSV summary: line, outputfile, status, ms and message of each item; false if it cannot be written
+bool WriteManifest(const std::string& path, const std::vector<BatchItem>& items,
+                   const std::vector<BatchResult>& results);
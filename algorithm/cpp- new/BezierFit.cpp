@@ -0,0 +1,195 @@
+#include "BezierFit.h"
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace
+{
+struct Vec2
+{
+    double x, y;
+    Vec2 operator+(Vec2 b) const { return {x + b.x, y + b.y}; }
+    Vec2 operator-(Vec2 b) const { return {x - b.x, y - b.y}; }
+    Vec2 operator*(double s) const { return {x * s, y * s}; }
+    double Dot(Vec2 b) const { return x * b.x + y * b.y; }
+    double Length() const { return std::hypot(x, y); }
+    Vec2 Unit() const
+    {
+        double l = Length();
+        return l > 0 ? Vec2{x / l, y / l} : Vec2{0, 0};
+    }
+};
+
+Vec2 Evaluate(const Vec2* c, double t)
+{
+    double s = 1 - t;
+    return c[0] * (s * s * s) + c[1] * (3 * s * s * t) + c[2] * (3 * s * t * t) + c[3] * (t * t * t);
+}
+
+// Cubic with end tangents t1 (leaving p[0]) and t2 (leaving p[n-1] backwards) whose tangent
+// lengths minimize the squared error at parameters u
+void FitCubic(const std::vector<Vec2>& p, const std::vector<double>& u, Vec2 t1, Vec2 t2, Vec2* c)
+{
+    const Vec2 a = p.front(), b = p.back();
+    double c00 = 0, c01 = 0, c11 = 0, x0 = 0, x1 = 0;
+    for (size_t i = 0; i < p.size(); i++)
+    {
+        double t = u[i], s = 1 - t;
+        double b0 = s * s * s, b1 = 3 * s * s * t, b2 = 3 * s * t * t, b3 = t * t * t;
+        Vec2 a1 = t1 * b1, a2 = t2 * b2;
+        c00 += a1.Dot(a1);
+        c01 += a1.Dot(a2);
+        c11 += a2.Dot(a2);
+        Vec2 rest = p[i] - (a * (b0 + b1) + b * (b2 + b3));
+        x0 += a1.Dot(rest);
+        x1 += a2.Dot(rest);
+    }
+    double det = c00 * c11 - c01 * c01;
+    double alpha1 = 0, alpha2 = 0;
+    if (std::abs(det) > 1e-12 * (c00 * c11 + 1e-300))
+    {
+        alpha1 = (x0 * c11 - x1 * c01) / det;
+        alpha2 = (c00 * x1 - c01 * x0) / det;
+    }
+    // degenerate or reversed tangents: the Wu/Barsky heuristic of a third of the chord
+    const double chord = (b - a).Length();
+    if (alpha1 < 1e-6 * chord || alpha2 < 1e-6 * chord)
+        alpha1 = alpha2 = chord / 3;
+    c[0] = a;
+    c[1] = a + t1 * alpha1;
+    c[2] = b + t2 * alpha2;
+    c[3] = b;
+}
+
+// squared distance of the worst point from the curve and its index
+double MaxError(const std::vector<Vec2>& p, const std::vector<double>& u, const Vec2* c, int& worst)
+{
+    double max_d2 = 0;
+    worst = (int)p.size() / 2;
+    for (size_t i = 1; i + 1 < p.size(); i++)
+    {
+        Vec2 d = Evaluate(c, u[i]) - p[i];
+        if (d.Dot(d) > max_d2)
+        {
+            max_d2 = d.Dot(d);
+            worst = (int)i;
+        }
+    }
+    return max_d2;
+}
+
+// one Newton step towards the parameter of the curve point nearest each data point
+void Reparameterize(const std::vector<Vec2>& p, std::vector<double>& u, const Vec2* c)
+{
+    const Vec2 d1[3] = {(c[1] - c[0]) * 3, (c[2] - c[1]) * 3, (c[3] - c[2]) * 3};
+    const Vec2 d2[2] = {(d1[1] - d1[0]) * 2, (d1[2] - d1[1]) * 2};
+    for (size_t i = 1; i + 1 < p.size(); i++)
+    {
+        double t = u[i], s = 1 - t;
+        Vec2 q = Evaluate(c, t) - p[i];
+        Vec2 q1 = d1[0] * (s * s) + d1[1] * (2 * s * t) + d1[2] * (t * t);
+        Vec2 q2 = d2[0] * s + d2[1] * t;
+        double den = q1.Dot(q1) + q.Dot(q2);
+        if (den != 0)
+            u[i] = std::clamp(t - q.Dot(q1) / den, 0.0, 1.0);
+    }
+}
+}
+
+int FitCubicBeziers(std::span<const double> xy, double tolerance, std::vector<double>& out, double corner_degrees)
+{
+    out.clear();
+    // repeated points carry no direction
+    std::vector<Vec2> points;
+    for (size_t i = 0; i + 1 < xy.size(); i += 2)
+        if (points.empty() || points.back().x != xy[i] || points.back().y != xy[i + 1])
+            points.push_back({xy[i], xy[i + 1]});
+    if (points.empty())
+        return 0;
+    out.push_back(points[0].x);
+    out.push_back(points[0].y);
+    const int n = (int)points.size();
+    if (n < 2)
+        return 0;
+
+    const double tolerance2 = tolerance * tolerance;
+    const double corner_cos = std::cos(corner_degrees * M_PI / 180);
+    int curves = 0;
+    std::vector<Vec2> p;
+    std::vector<double> u;
+    auto emit = [&](const Vec2* c)
+    {
+        for (int k = 1; k < 4; k++)
+        {
+            out.push_back(c[k].x);
+            out.push_back(c[k].y);
+        }
+        curves++;
+    };
+
+    // smooth runs between corners, each fitted by splitting at the worst point (an explicit
+    // stack of spans, left span on top so the curves come out in order)
+    struct Span
+    {
+        int first, last;
+        Vec2 t1, t2;
+    };
+    std::vector<Span> spans;
+    for (int first = 0; first < n - 1;)
+    {
+        int last = first + 1;
+        while (last < n - 1 &&
+               (points[last] - points[last - 1]).Unit().Dot((points[last + 1] - points[last]).Unit()) >= corner_cos)
+            last++;
+        spans.push_back({first, last, (points[first + 1] - points[first]).Unit(),
+                         (points[last - 1] - points[last]).Unit()});
+        while (!spans.empty())
+        {
+            Span s = spans.back();
+            spans.pop_back();
+            Vec2 c[4];
+            if (s.last - s.first == 1)
+            {
+                // keeps the tangents shared with the neighbouring curves (a straight line at corners)
+                double third = (points[s.last] - points[s.first]).Length() / 3;
+                c[0] = points[s.first];
+                c[1] = points[s.first] + s.t1 * third;
+                c[2] = points[s.last] + s.t2 * third;
+                c[3] = points[s.last];
+                emit(c);
+                continue;
+            }
+
+            p.assign(points.begin() + s.first, points.begin() + s.last + 1);
+            u.assign(p.size(), 0);
+            for (size_t i = 1; i < p.size(); i++)
+                u[i] = u[i - 1] + (p[i] - p[i - 1]).Length();
+            for (double& t : u)
+                t /= u.back();
+
+            int worst;
+            FitCubic(p, u, s.t1, s.t2, c);
+            double error = MaxError(p, u, c, worst);
+            // close misses are usually a parameterization problem rather than a shape one
+            for (int iteration = 0; iteration < 4 && error > tolerance2 && error < 16 * tolerance2; iteration++)
+            {
+                Reparameterize(p, u, c);
+                FitCubic(p, u, s.t1, s.t2, c);
+                error = MaxError(p, u, c, worst);
+            }
+            if (error <= tolerance2)
+            {
+                emit(c);
+                continue;
+            }
+            const int split = s.first + worst;
+            Vec2 center = (points[split - 1] - points[split + 1]).Unit();
+            if (center.Dot(center) == 0)
+                center = (points[split - 1] - points[split]).Unit();
+            spans.push_back({split, s.last, center * -1, s.t2});
+            spans.push_back({s.first, split, s.t1, center});
+        }
+        first = last;
+    }
+    return curves;
+}
@@ -0,0 +1,16 @@
+#pragma once
+#include <span>
+#include <vector>
+
+// Fits a polyline (x, y pairs) with a chain of cubic Bezier curves that pass within tolerance of
+// every point (same units as xy). out gets the start point followed by control point 1,
+// control point 2 and end point of each cubic, the layout PathWriter::Bezier takes.
+//
+// Curves are fitted by least squares on chord-length parameters (Schneider, Graphics Gems I),
+// refined by Newton steps and split at the worst point while the error is too large. The split
+// point's tangent is shared by both halves, so the chain is G1 except where the polyline turns
+// by more than corner_degrees at a vertex, which stays a corner. On the densely sampled, smooth
+// chains of an unwrapped strip a few curves replace thousands of segments. Returns the number
+// of curves.
+int FitCubicBeziers(std::span<const double> xy, double tolerance, std::vector<double>& out,
+                    double corner_degrees = 45);
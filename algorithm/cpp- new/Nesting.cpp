@@ -0,0 +1,324 @@
+#include "Nesting.h"
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <numeric>
+
+// Convex hull (Andrew's monotone chain), counter-clockwise, as x, y pairs
+static std::vector<double> ConvexHull(const std::vector<double>& xy)
+{
+    const int n = (int)xy.size() / 2;
+    std::vector<int> idx(n);
+    std::iota(idx.begin(), idx.end(), 0);
+    std::sort(idx.begin(), idx.end(), [&](int a, int b)
+    {
+        return xy[2 * a] < xy[2 * b] || (xy[2 * a] == xy[2 * b] && xy[2 * a + 1] < xy[2 * b + 1]);
+    });
+    auto cross = [&](int o, int a, int b)
+    {
+        return (xy[2 * a] - xy[2 * o]) * (xy[2 * b + 1] - xy[2 * o + 1]) -
+            (xy[2 * a + 1] - xy[2 * o + 1]) * (xy[2 * b] - xy[2 * o]);
+    };
+    std::vector<int> hull(2 * n);
+    int k = 0;
+    for (int i = 0; i < n; i++)
+    {
+        while (k >= 2 && cross(hull[k - 2], hull[k - 1], idx[i]) <= 0)
+            k--;
+        hull[k++] = idx[i];
+    }
+    for (int i = n - 2, lower = k + 1; i >= 0; i--)
+    {
+        while (k >= lower && cross(hull[k - 2], hull[k - 1], idx[i]) <= 0)
+            k--;
+        hull[k++] = idx[i];
+    }
+    std::vector<double> out;
+    for (int i = 0; i < std::max(1, k - 1) && i < n; i++)
+    {
+        out.push_back(xy[2 * hull[i]]);
+        out.push_back(xy[2 * hull[i] + 1]);
+    }
+    return out;
+}
+
+static double PolygonArea(const std::vector<double>& p)
+{
+    double a = 0;
+    const int n = (int)p.size() / 2;
+    for (int i = 0; i < n; i++)
+    {
+        int j = (i + 1) % n;
+        a += p[2 * i] * p[2 * j + 1] - p[2 * j] * p[2 * i + 1];
+    }
+    return 0.5 * std::abs(a);
+}
+
+// A rotated hull in raster cells: row j of the hull covers cells [run[j].first, run[j].second)
+// (a convex polygon meets every row in one run); halo is the same dilated by the gap
+struct HullMask
+{
+    double min_x, min_y; // rotated hull's bounding box corner, at cell (0, 0)
+    int w, h;            // cells
+    std::vector<std::pair<int, int>> run;
+    int g;               // dilation in cells; halo row j is hull row j - g
+    std::vector<std::pair<int, int>> halo;
+};
+
+static HullMask RasterizeHull(const std::vector<double>& hull, double angle, double res, double gap)
+{
+    const int n = (int)hull.size() / 2;
+    const double c = std::cos(angle), s = std::sin(angle);
+    std::vector<double> p(2 * n);
+    HullMask m;
+    m.min_x = m.min_y = INFINITY;
+    double max_x = -INFINITY, max_y = -INFINITY;
+    for (int i = 0; i < n; i++)
+    {
+        p[2 * i] = c * hull[2 * i] - s * hull[2 * i + 1];
+        p[2 * i + 1] = s * hull[2 * i] + c * hull[2 * i + 1];
+        m.min_x = std::min(m.min_x, p[2 * i]);
+        m.min_y = std::min(m.min_y, p[2 * i + 1]);
+        max_x = std::max(max_x, p[2 * i]);
+        max_y = std::max(max_y, p[2 * i + 1]);
+    }
+    for (int i = 0; i < n; i++)
+    {
+        p[2 * i] -= m.min_x;
+        p[2 * i + 1] -= m.min_y;
+    }
+    m.w = std::max(1, (int)std::ceil((max_x - m.min_x) / res));
+    m.h = std::max(1, (int)std::ceil((max_y - m.min_y) / res));
+
+    // x extent of the polygon within each row's band, from the vertices and edge crossings in it
+    m.run.assign(m.h, {m.w, 0});
+    auto cover = [&](double x, double y_lo, double y_hi)
+    {
+        int j0 = std::clamp((int)std::floor(y_lo / res), 0, m.h - 1);
+        int j1 = std::clamp((int)std::floor(y_hi / res), 0, m.h - 1);
+        int x0 = std::clamp((int)std::floor(x / res), 0, m.w - 1);
+        for (int j = j0; j <= j1; j++)
+        {
+            m.run[j].first = std::min(m.run[j].first, x0);
+            m.run[j].second = std::max(m.run[j].second, x0 + 1);
+        }
+    };
+    for (int i = 0; i < n; i++)
+    {
+        double ax = p[2 * i], ay = p[2 * i + 1];
+        double bx = p[2 * ((i + 1) % n)], by = p[2 * ((i + 1) % n) + 1];
+        cover(ax, ay, ay);
+        if (ay == by)
+            continue;
+        // crossings of the edge with the row boundaries it spans
+        double lo = std::min(ay, by), hi = std::max(ay, by);
+        for (int j = (int)std::ceil(lo / res); j * res <= hi; j++)
+        {
+            double x = ax + (j * res - ay) / (by - ay) * (bx - ax);
+            cover(x, j * res - 1e-9 * res, j * res);
+        }
+    }
+    for (auto& r : m.run)
+        if (r.first >= r.second)
+            r = {0, m.w};
+
+    m.g = (int)std::ceil(gap / res);
+    m.halo.assign(m.h + 2 * m.g, {m.w + m.g, -m.g});
+    for (int j = 0; j < m.h; j++)
+    {
+        for (int k = j; k <= j + 2 * m.g; k++)
+        {
+            m.halo[k].first = std::min(m.halo[k].first, m.run[j].first - m.g);
+            m.halo[k].second = std::max(m.halo[k].second, m.run[j].second + m.g);
+        }
+    }
+    return m;
+}
+
+// Occupied cells of a sheet; last[row][x] is the last occupied cell <= x in the row, or -1
+struct SheetRaster
+{
+    int cols, rows;
+    std::vector<std::vector<int>> last;
+    std::map<std::pair<int, int>, std::pair<int, int>> resume; // (shape, rotation) -> (x, y) to scan from
+
+    SheetRaster(int cols, int rows) : cols(cols), rows(rows), last(rows, std::vector<int>(cols, -1)) {}
+
+    // next_x is -1 if m fits with its cell (0, 0) at (x, y), else the next x in the row that
+    // clears every blocking cell found
+    void Fit(const HullMask& m, int x, int y, int& next_x) const
+    {
+        next_x = -1;
+        for (int k = 0; k < (int)m.halo.size(); k++)
+        {
+            int row = y - m.g + k;
+            if (row < 0 || row >= rows)
+                continue;
+            int a = std::max(0, x + m.halo[k].first);
+            int b = std::min(cols, x + m.halo[k].second);
+            if (a >= b)
+                continue;
+            int blocker = last[row][b - 1];
+            if (blocker >= a)
+                next_x = std::max(next_x, blocker + 1 - m.halo[k].first);
+        }
+    }
+
+    void Mark(const HullMask& m, int x, int y)
+    {
+        for (int j = 0; j < m.h; j++)
+        {
+            std::vector<int>& l = last[y + j];
+            int a = x + m.run[j].first, b = x + m.run[j].second;
+            for (int i = a; i < b; i++)
+                l[i] = i;
+            for (int i = b; i < cols && l[i] < b - 1; i++)
+                l[i] = b - 1;
+        }
+    }
+
+    // lowest, then leftmost position of m at or after (x, y) in scan order; false if none. A
+    // sheet only fills up, so a mask's position never moves back and the scan for the next copy
+    // of a shape resumes where the last one stopped.
+    bool BottomLeft(const HullMask& m, int& best_x, int& best_y, int x = 0, int y = 0) const
+    {
+        for (; y + m.h <= rows; y++, x = 0)
+        {
+            while (x + m.w <= cols)
+            {
+                int next_x;
+                Fit(m, x, y, next_x);
+                if (next_x < 0)
+                {
+                    best_x = x;
+                    best_y = y;
+                    return true;
+                }
+                x = std::max(x + 1, next_x);
+            }
+        }
+        return false;
+    }
+};
+
+NestResult NestOnSheets(const std::vector<NestItem>& items, double sheet_w, double sheet_h, double margin, double gap,
+                        int rotations, double resolution)
+{
+    NestResult result;
+    result.placements.resize(items.size());
+    const double res = resolution > 0 ? resolution : std::max(sheet_w, sheet_h) / 400;
+    const int cols = std::max(1, (int)std::floor((sheet_w - 2 * margin) / res));
+    const int rows = std::max(1, (int)std::floor((sheet_h - 2 * margin) / res));
+    rotations = std::max(1, rotations);
+
+    std::vector<std::vector<double>> hulls(items.size());
+    std::vector<double> area(items.size());
+    for (size_t i = 0; i < items.size(); i++)
+    {
+        hulls[i] = items[i].paths.xy.empty() ? std::vector<double>{0, 0} : ConvexHull(items[i].paths.xy);
+        area[i] = PolygonArea(hulls[i]);
+    }
+    std::vector<int> order(items.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return area[a] > area[b]; });
+
+    std::map<std::pair<int, int>, HullMask> cache; // (shape, rotation)
+    std::vector<SheetRaster> sheets;
+    std::vector<double> used;
+    for (int i : order)
+    {
+        std::vector<HullMask> local;
+        std::vector<const HullMask*> masks;
+        for (int r = 0; r < rotations; r++)
+        {
+            double angle = 2 * M_PI * r / rotations;
+            if (items[i].shape >= 0)
+            {
+                auto key = std::make_pair(items[i].shape, r);
+                auto it = cache.find(key);
+                if (it == cache.end())
+                    it = cache.emplace(key, RasterizeHull(hulls[i], angle, res, gap)).first;
+                masks.push_back(&it->second);
+            }
+            else
+            {
+                local.push_back(RasterizeHull(hulls[i], angle, res, gap));
+            }
+        }
+        for (const HullMask& m : local)
+            masks.push_back(&m);
+
+        // first sheet with room; on it the rotation whose top ends lowest, then leftmost
+        NestPlacement& place = result.placements[i];
+        for (size_t s = 0; s <= sheets.size() && place.sheet < 0; s++)
+        {
+            if (s == sheets.size())
+                sheets.emplace_back(cols, rows), used.push_back(0);
+            int best_r = -1, best_x = 0, best_y = 0;
+            for (int r = 0; r < rotations; r++)
+            {
+                int x = 0, y = 0;
+                std::pair<int, int>* from = nullptr;
+                if (items[i].shape >= 0)
+                {
+                    auto it = sheets[s].resume.try_emplace({items[i].shape, r}, 0, 0).first;
+                    from = &it->second;
+                    x = from->first;
+                    y = from->second;
+                }
+                bool found = sheets[s].BottomLeft(*masks[r], x, y, x, y);
+                if (from)
+                    *from = found ? std::make_pair(x, y) : std::make_pair(0, rows);
+                if (!found)
+                    continue;
+                if (best_r < 0 || y + masks[r]->h < best_y + masks[best_r]->h ||
+                    (y + masks[r]->h == best_y + masks[best_r]->h && x < best_x))
+                {
+                    best_r = r;
+                    best_x = x;
+                    best_y = y;
+                }
+            }
+            if (best_r < 0)
+            {
+                // nothing fits even an empty sheet: leave the item out
+                if (used[s] == 0)
+                {
+                    sheets.pop_back();
+                    used.pop_back();
+                    break;
+                }
+                continue;
+            }
+            const HullMask& m = *masks[best_r];
+            sheets[s].Mark(m, best_x, best_y);
+            used[s] += area[i];
+            place.sheet = (int)s;
+            place.angle = 2 * M_PI * best_r / rotations;
+            place.dx = margin + best_x * res - m.min_x;
+            place.dy = margin + best_y * res - m.min_y;
+        }
+    }
+
+    result.sheets = (int)sheets.size();
+    double total = 0;
+    for (double u : used)
+    {
+        result.hull_coverage.push_back(u / (sheet_w * sheet_h));
+        total += u;
+    }
+    result.total_hull_coverage = result.sheets > 0 ? total / (result.sheets * sheet_w * sheet_h) : 0;
+    return result;
+}
+
+void PlaceNestItem(const PolylineSet& paths, const NestPlacement& placement, PolylineSet& out)
+{
+    const double c = std::cos(placement.angle), s = std::sin(placement.angle);
+    for (int k = 0; k < paths.Count(); k++)
+    {
+        std::span<const double> p = paths[k];
+        out.NewPolyline();
+        for (size_t i = 0; i < p.size(); i += 2)
+            out.Append(c * p[i] - s * p[i + 1] + placement.dx, s * p[i] + c * p[i + 1] + placement.dy);
+    }
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include "TemplateWriter.h"
+
+// One template to nest: its cut paths in points (any origin). Items with the same shape >= 0
+// have the same outline and share its rasterized rotations.
+struct NestItem
+{
+    PolylineSet paths;
+    int shape = -1;
+};
+
+// Where an item went: page point = rotate(p, angle) + (dx, dy) on sheet; sheet -1 if the item
+// fits on no sheet in any rotation
+struct NestPlacement
+{
+    int sheet = -1;
+    double angle = 0;
+    double dx = 0, dy = 0;
+};
+
+struct NestResult
+{
+    std::vector<NestPlacement> placements; // per item, in input order
+    int sheets = 0;
+    std::vector<double> hull_coverage;     // per sheet: convex hull area of its items / sheet area
+    double total_hull_coverage = 0;        // over all sheets; an upper bound on the material used
+};
+
+// Packs the items' convex hulls onto as few sheet_w x sheet_h sheets as the bottom-left-fill
+// heuristic finds: largest hull first, each at the lowest-then-leftmost position (over the
+// rotation candidates k * 360 / rotations degrees) on the first sheet where it fits. Sheets
+// are rasterized in cells of resolution points (0: about 1/400 of the longer side); hull masks
+// are cached per shape and rotation and each mask row is one run, so a fit test costs one
+// lookup per row and a failed row skips past the blocking cell. Hulls keep gap points apart
+// and margin points from the sheet edges.
+NestResult NestOnSheets(const std::vector<NestItem>& items, double sheet_w, double sheet_h, double margin = 18,
+                        double gap = 6, int rotations = 4, double resolution = 0);
+
+// Appends paths moved to their place on the sheet
+void PlaceNestItem(const PolylineSet& paths, const NestPlacement& placement, PolylineSet& out);
@@ -0,0 +1,109 @@
+#include "PageTiling.h"
+#include <algorithm>
+#include <cmath>
+
+TileGrid PlanTiles(double layout_w, double layout_h, const PageDimensions& page, double margin, double overlap)
+{
+    TileGrid grid;
+    grid.margin = margin;
+    grid.window_w = std::max(1.0, page.width_pt - 2 * margin);
+    grid.window_h = std::max(1.0, page.height_pt - 2 * margin);
+    grid.overlap = std::clamp(overlap, 0.0, 0.5 * std::min(grid.window_w, grid.window_h));
+    grid.step_x = grid.window_w - grid.overlap;
+    grid.step_y = grid.window_h - grid.overlap;
+    grid.cols = std::max(1, (int)std::ceil((layout_w - grid.overlap) / grid.step_x));
+    grid.rows = std::max(1, (int)std::ceil((layout_h - grid.overlap) / grid.step_y));
+    return grid;
+}
+
+// Liang-Barsky: the part [t0, t1] of p + t (q - p), t in [0, 1], inside the box; false if none
+static bool ClipSegment(double px, double py, double qx, double qy, double x0, double y0, double x1, double y1,
+                        double& t0, double& t1)
+{
+    t0 = 0;
+    t1 = 1;
+    const double dx = qx - px, dy = qy - py;
+    const double pk[4] = {-dx, dx, -dy, dy};
+    const double qk[4] = {px - x0, x1 - px, py - y0, y1 - py};
+    for (int k = 0; k < 4; k++)
+    {
+        if (pk[k] == 0)
+        {
+            if (qk[k] < 0)
+                return false;
+            continue;
+        }
+        double t = qk[k] / pk[k];
+        if (pk[k] < 0)
+            t0 = std::max(t0, t);
+        else
+            t1 = std::min(t1, t);
+        if (t0 > t1)
+            return false;
+    }
+    return true;
+}
+
+void ClipToTiles(const PolylineSet& paths, const TileGrid& grid, std::vector<PolylineSet>& tiles)
+{
+    tiles.assign(grid.Count(), PolylineSet());
+    // per tile, the running segment number whose piece reached the segment's end point
+    std::vector<long long> open_until(grid.Count(), -2);
+    long long segment = 0;
+
+    // tiles whose window [i * step, i * step + window] meets [a, b]
+    auto range = [](double a, double b, double step, double window, int n, int& first, int& last)
+    {
+        first = std::max(0, (int)std::ceil((a - window) / step));
+        last = std::min(n - 1, (int)std::floor(b / step));
+    };
+
+    for (int k = 0; k < paths.Count(); k++, segment++)
+    {
+        std::span<const double> p = paths[k];
+        for (size_t i = 0; i + 3 < p.size(); i += 2, segment++)
+        {
+            const double px = p[i], py = p[i + 1], qx = p[i + 2], qy = p[i + 3];
+            int c0, c1, r0, r1;
+            range(std::min(px, qx), std::max(px, qx), grid.step_x, grid.window_w, grid.cols, c0, c1);
+            range(std::min(py, qy), std::max(py, qy), grid.step_y, grid.window_h, grid.rows, r0, r1);
+            for (int r = r0; r <= r1; r++)
+            {
+                for (int c = c0; c <= c1; c++)
+                {
+                    const double wx = c * grid.step_x, wy = r * grid.step_y;
+                    double t0, t1;
+                    if (!ClipSegment(px, py, qx, qy, wx, wy, wx + grid.window_w, wy + grid.window_h, t0, t1))
+                        continue;
+                    const int tile = r * grid.cols + c;
+                    PolylineSet& out = tiles[tile];
+                    const double ox = grid.margin - wx, oy = grid.margin - wy;
+                    if (!(t0 == 0 && open_until[tile] == segment - 1))
+                    {
+                        out.NewPolyline();
+                        out.Append(px + t0 * (qx - px) + ox, py + t0 * (qy - py) + oy);
+                    }
+                    out.Append(px + t1 * (qx - px) + ox, py + t1 * (qy - py) + oy);
+                    open_until[tile] = t1 == 1 ? segment : -2;
+                }
+            }
+        }
+    }
+}
+
+void AddRegistrationMarks(const TileGrid& grid, int col, int row, PolylineSet& page, double size)
+{
+    const double wx = col * grid.step_x, wy = row * grid.step_y;
+    for (int j = row; j <= row + 1; j++)
+    {
+        for (int i = col; i <= col + 1; i++)
+        {
+            double x = i * grid.step_x + 0.5 * grid.overlap - wx + grid.margin;
+            double y = j * grid.step_y + 0.5 * grid.overlap - wy + grid.margin;
+            const double horizontal[4] = {x - size, y, x + size, y};
+            const double vertical[4] = {x, y - size, x, y + size};
+            page.Add(horizontal);
+            page.Add(vertical);
+        }
+    }
+}
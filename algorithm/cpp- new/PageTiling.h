@@ -0,0 +1,30 @@
+#pragma once
+#include "TemplateWriter.h"
+
+// Layout split into a grid of page-sized windows that overlap by overlap points. Window (c, r)
+// covers layout x in [c * step_x, c * step_x + window_w] (same for y) and is printed at
+// (margin, margin) on its page.
+struct TileGrid
+{
+    double margin, overlap;
+    double window_w, window_h;
+    double step_x, step_y;
+    int cols, rows;
+
+    int Count() const { return cols * rows; }
+};
+
+// Fewest tiles covering a layout_w x layout_h points layout (origin at 0, 0) on page
+TileGrid PlanTiles(double layout_w, double layout_h, const PageDimensions& page, double margin = 18,
+                   double overlap = 28.35);
+
+// Clips paths (layout points) to every tile they cross; tiles[r * cols + c] gets its pieces in
+// page points. Each segment is only tested against the tiles its bounding box reaches, so the
+// cost is linear in the segments, not segments x tiles. Pieces that continue across a segment
+// boundary stay one polyline.
+void ClipToTiles(const PolylineSet& paths, const TileGrid& grid, std::vector<PolylineSet>& tiles);
+
+// Crosses of arm length size at the points (i * step_x + overlap / 2, j * step_y + overlap / 2)
+// that fall in tile (col, row), i.e. in the middle of each overlap corner, so the marks of
+// neighbouring pages coincide when the pages are aligned
+void AddRegistrationMarks(const TileGrid& grid, int col, int row, PolylineSet& page, double size = 8);
@@ -0,0 +1,36 @@
+#pragma once
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+// Set on threads that already share the cores with other workers (the -batch pool): ParallelFor
+// runs inline on them instead of starting another thread per core for every call.
+inline thread_local bool parallel_serial = false;
+
+// Runs body(begin, end) over [0, n) split into one contiguous chunk per hardware thread.
+// Ranges smaller than two chunks of min_chunk items, and calls on a parallel_serial thread, run
+// inline on the calling thread.
+template <typename Body>
+void ParallelFor(int n, Body body, int min_chunk = 4096)
+{
+    int nthreads = parallel_serial ? 1 : std::max(1, (int)std::thread::hardware_concurrency());
+    nthreads = std::min(nthreads, n / std::max(1, min_chunk));
+    if (nthreads <= 1)
+    {
+        body(0, n);
+        return;
+    }
+
+    std::vector<std::thread> threads;
+    threads.reserve(nthreads - 1);
+    int chunk = (n + nthreads - 1) / nthreads;
+    for (int t = 1; t < nthreads; t++)
+    {
+        int begin = std::min(n, t * chunk);
+        int end = std::min(n, begin + chunk);
+        threads.emplace_back(body, begin, end);
+    }
+    body(0, std::min(n, chunk));
+    for (auto& thread : threads)
+        thread.join();
+}
@@ -0,0 +1,304 @@
+#include "PathOrder.h"
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+// Uniform grid over points (x, y pairs) with O(1) removal, for nearest-point queries. The
+// coordinates are copied in cell order so a query reads them sequentially.
+class PointGrid
+{
+public:
+    explicit PointGrid(const std::vector<double>& xy) : xy(xy)
+    {
+        const int n = (int)xy.size() / 2;
+        double x1 = -INFINITY, y1 = -INFINITY;
+        x0 = y0 = INFINITY;
+        for (int i = 0; i < n; i++)
+        {
+            x0 = std::min(x0, xy[2 * i]);
+            x1 = std::max(x1, xy[2 * i]);
+            y0 = std::min(y0, xy[2 * i + 1]);
+            y1 = std::max(y1, xy[2 * i + 1]);
+        }
+        // about two points per cell
+        double w = std::max(x1 - x0, 0.0), h = std::max(y1 - y0, 0.0);
+        cell = std::sqrt(std::max(w * h, 1e-12) / std::max(1, n / 2));
+        cell = std::max({cell, std::max(w, h) / std::max(1, n), 1e-9});
+        nx = std::min(std::max(1, (int)(w / cell) + 1), 4 * n + 1);
+        ny = std::min(std::max(1, (int)(h / cell) + 1), 4 * n + 1);
+
+        first.assign(nx * ny + 1, 0);
+        for (int i = 0; i < n; i++)
+            first[CellOf(i) + 1]++;
+        for (int c = 0; c < nx * ny; c++)
+            first[c + 1] += first[c];
+        count.assign(nx * ny, 0);
+        items.resize(n);
+        item_xy.resize(2 * n);
+        slot.resize(n);
+        for (int i = 0; i < n; i++)
+        {
+            int c = CellOf(i);
+            slot[i] = first[c] + count[c];
+            items[slot[i]] = i;
+            item_xy[2 * slot[i]] = xy[2 * i];
+            item_xy[2 * slot[i] + 1] = xy[2 * i + 1];
+            count[c]++;
+        }
+    }
+
+    void Remove(int i)
+    {
+        int c = CellOf(i);
+        int s = first[c] + --count[c], last = items[s];
+        items[slot[i]] = last;
+        item_xy[2 * slot[i]] = item_xy[2 * s];
+        item_xy[2 * slot[i] + 1] = item_xy[2 * s + 1];
+        slot[last] = slot[i];
+    }
+
+    // up to k nearest points for which accept(i) holds, nearest first, with squared distances
+    template <typename Accept>
+    void Nearest(double x, double y, int k, Accept accept, std::vector<std::pair<double, int>>& found) const
+    {
+        found.clear();
+        int cx = (int)std::floor((x - x0) / cell);
+        int cy = (int)std::floor((y - y0) / cell);
+        // rings of cells around (cx, cy), which may lie outside the grid; everything in ring
+        // r + 1 is at least r * cell away. Rings before min_ring miss the grid.
+        int min_ring = std::max({0, -cx, cx - (nx - 1), -cy, cy - (ny - 1)});
+        int max_ring = std::max({std::abs(cx), std::abs(cx - nx), std::abs(cy), std::abs(cy - ny)}) + 1;
+        for (int r = min_ring; r <= max_ring; r++)
+        {
+            auto visit = [&](int gx, int gy)
+            {
+                int c = gy * nx + gx;
+                for (int s = first[c]; s < first[c] + count[c]; s++)
+                {
+                    int i = items[s];
+                    if (!accept(i))
+                        continue;
+                    double dx = item_xy[2 * s] - x, dy = item_xy[2 * s + 1] - y;
+                    double d = dx * dx + dy * dy;
+                    if ((int)found.size() < k || d < found.back().first)
+                    {
+                        if ((int)found.size() == k)
+                            found.pop_back();
+                        found.insert(std::upper_bound(found.begin(), found.end(), std::make_pair(d, i)),
+                                     std::make_pair(d, i));
+                    }
+                }
+            };
+            const int gx0 = std::max(cx - r, 0), gx1 = std::min(cx + r, nx - 1);
+            const int gy0 = std::max(cy - r + 1, 0), gy1 = std::min(cy + r - 1, ny - 1);
+            for (int gy : {cy - r, cy + r})
+            {
+                if (gy >= 0 && gy < ny)
+                    for (int gx = gx0; gx <= gx1; gx++)
+                        visit(gx, gy);
+                if (r == 0)
+                    break;
+            }
+            for (int gx : {cx - r, cx + r})
+            {
+                if (r > 0 && gx >= 0 && gx < nx)
+                    for (int gy = gy0; gy <= gy1; gy++)
+                        visit(gx, gy);
+            }
+            if ((int)found.size() == k && found.back().first <= (r * cell) * (r * cell))
+                break;
+        }
+    }
+
+private:
+    int CellOf(int i) const
+    {
+        int gx = std::clamp((int)((xy[2 * i] - x0) / cell), 0, nx - 1);
+        int gy = std::clamp((int)((xy[2 * i + 1] - y0) / cell), 0, ny - 1);
+        return gy * nx + gx;
+    }
+
+    const std::vector<double>& xy;
+    double x0, y0, cell;
+    int nx, ny;
+    std::vector<int> first, count, items, slot;
+    std::vector<double> item_xy;
+};
+
+double TravelDistance(const PolylineSet& paths, double start_x, double start_y)
+{
+    double travel = 0, x = start_x, y = start_y;
+    for (int k = 0; k < paths.Count(); k++)
+    {
+        std::span<const double> p = paths[k];
+        if (p.empty())
+            continue;
+        travel += std::hypot(p[0] - x, p[1] - y);
+        x = p[p.size() - 2];
+        y = p[p.size() - 1];
+    }
+    return travel;
+}
+
+TravelStats OptimizePathOrder(PolylineSet& paths, double start_x, double start_y, int max_passes)
+{
+    TravelStats stats;
+    stats.before = TravelDistance(paths, start_x, start_y);
+    // empty polylines draw nothing
+    if (std::adjacent_find(paths.starts.begin(), paths.starts.end()) != paths.starts.end())
+    {
+        PolylineSet kept;
+        for (int k = 0; k < paths.Count(); k++)
+            if (paths.Points(k) > 0)
+                kept.Add(paths[k]);
+        paths = std::move(kept);
+    }
+    const int n = paths.Count();
+    if (n < 2)
+    {
+        stats.after = stats.before;
+        return stats;
+    }
+
+    // endpoint 2k is the first and 2k+1 the last point of polyline k
+    std::vector<double> ends(4 * n);
+    for (int k = 0; k < n; k++)
+    {
+        std::span<const double> p = paths[k];
+        ends[4 * k] = p[0];
+        ends[4 * k + 1] = p[1];
+        ends[4 * k + 2] = p[p.size() - 2];
+        ends[4 * k + 3] = p[p.size() - 1];
+    }
+
+    // nearest-neighbour tour: enter the polyline with the nearest free endpoint there
+    std::vector<int> tour(n);
+    std::vector<char> reversed(n);
+    {
+        PointGrid grid(ends);
+        std::vector<std::pair<double, int>> found;
+        double x = start_x, y = start_y;
+        for (int t = 0; t < n; t++)
+        {
+            grid.Nearest(x, y, 1, [](int) { return true; }, found);
+            int e = found[0].second, k = e / 2;
+            grid.Remove(2 * k);
+            grid.Remove(2 * k + 1);
+            tour[t] = k;
+            reversed[k] = e % 2;
+            int exit = e ^ 1;
+            x = ends[2 * exit];
+            y = ends[2 * exit + 1];
+        }
+    }
+
+    // 2-opt over the tour: reversing positions lo+1 .. hi replaces the travel moves
+    // exit(lo) -> entry(lo+1) and exit(hi) -> entry(hi+1) by exit(lo) -> exit(hi) and
+    // entry(lo+1) -> entry(hi+1); position -1 is the start point
+    const int K = 8, max_reversal = 1000;
+    std::vector<std::vector<int>> near(2 * n);
+    std::vector<int> near_start;
+    {
+        PointGrid grid(ends);
+        std::vector<std::pair<double, int>> found;
+        for (int e = 0; e < 2 * n; e++)
+        {
+            grid.Nearest(ends[2 * e], ends[2 * e + 1], K, [&](int i) { return i / 2 != e / 2; }, found);
+            for (auto& f : found)
+                near[e].push_back(f.second);
+        }
+        grid.Nearest(start_x, start_y, K, [](int) { return true; }, found);
+        for (auto& f : found)
+            near_start.push_back(f.second);
+    }
+
+    std::vector<int> pos(n);
+    for (int t = 0; t < n; t++)
+        pos[tour[t]] = t;
+    auto entry = [&](int t) { return 2 * tour[t] + reversed[tour[t]]; };
+    auto exit = [&](int t) { return 2 * tour[t] + 1 - reversed[tour[t]]; };
+    auto dist = [&](int t_exit, int e)
+    {
+        // from the exit of position t_exit (or the start point) to endpoint e
+        double x = t_exit < 0 ? start_x : ends[2 * exit(t_exit)];
+        double y = t_exit < 0 ? start_y : ends[2 * exit(t_exit) + 1];
+        return std::hypot(ends[2 * e] - x, ends[2 * e + 1] - y);
+    };
+    auto between = [&](int a, int b) { return std::hypot(ends[2 * a] - ends[2 * b], ends[2 * a + 1] - ends[2 * b + 1]); };
+    double gain = 0;
+    auto try_move = [&](int lo, int hi)
+    {
+        if (lo > hi)
+            std::swap(lo, hi);
+        // long reversals cost O(n) each and rarely pay off for a local move
+        if (lo == hi || hi - lo > max_reversal)
+            return false;
+        bool tail = hi + 1 < n;
+        double before = dist(lo, entry(lo + 1)) + (tail ? between(exit(hi), entry(hi + 1)) : 0);
+        double after = dist(lo, exit(hi)) + (tail ? between(entry(lo + 1), entry(hi + 1)) : 0);
+        if (after >= before - 1e-9 * (1 + before))
+            return false;
+        gain += before - after;
+        std::reverse(tour.begin() + lo + 1, tour.begin() + hi + 1);
+        for (int t = lo + 1; t <= hi; t++)
+        {
+            reversed[tour[t]] ^= 1;
+            pos[tour[t]] = t;
+        }
+        return true;
+    };
+
+    // passes stop once one shortens the travel by less than 0.1%
+    double travel = dist(-1, entry(0));
+    for (int t = 0; t + 1 < n; t++)
+        travel += between(exit(t), entry(t + 1));
+    for (int pass = 0; pass < max_passes; pass++)
+    {
+        bool improved = false;
+        gain = 0;
+        for (int i = -1; i < n - 1; i++)
+        {
+            // new move exit(i) -> exit(p) for exits p near exit(i)
+            for (int e : i < 0 ? near_start : near[exit(i)])
+            {
+                int p = pos[e / 2];
+                if (exit(p) == e && p != i)
+                    improved |= try_move(i, p);
+            }
+            // new move entry(i+1) -> entry(p+1) for entries p+1 near entry(i+1)
+            for (int e : near[entry(i + 1)])
+            {
+                int p = pos[e / 2] - 1;
+                if (entry(p + 1) == e && p != i)
+                    improved |= try_move(i, p);
+            }
+        }
+        if (!improved || gain < 1e-3 * travel)
+            break;
+        travel -= gain;
+    }
+
+    PolylineSet ordered;
+    ordered.xy.reserve(paths.xy.size());
+    ordered.starts.reserve(n + 1);
+    std::vector<double> flipped;
+    for (int t = 0; t < n; t++)
+    {
+        std::span<const double> p = paths[tour[t]];
+        if (!reversed[tour[t]])
+        {
+            ordered.Add(p);
+            continue;
+        }
+        flipped.clear();
+        for (size_t i = p.size(); i >= 2; i -= 2)
+        {
+            flipped.push_back(p[i - 2]);
+            flipped.push_back(p[i - 1]);
+        }
+        ordered.Add(flipped);
+    }
+    paths = std::move(ordered);
+    stats.after = TravelDistance(paths, start_x, start_y);
+    return stats;
+}
@@ -0,0 +1,18 @@
+#pragma once
+#include "TemplateWriter.h"
+
+// Pen-up travel of a plotter or drag knife cutting paths in order from (start_x, start_y)
+struct TravelStats
+{
+    double before = 0;
+    double after = 0;
+};
+
+// Total pen-up distance: from the start point to the first polyline and between consecutive ones
+double TravelDistance(const PolylineSet& paths, double start_x = 0, double start_y = 0);
+
+// Reorders and reverses polylines to cut down pen-up travel: a nearest-neighbour tour from the
+// start point, then 2-opt moves (reversing runs of polylines) between endpoints that are among
+// each other's nearest neighbours. Endpoints are looked up in a uniform grid, so both passes
+// stay near O(n) for layouts with many polylines. The polylines' shapes are unchanged.
+TravelStats OptimizePathOrder(PolylineSet& paths, double start_x = 0, double start_y = 0, int max_passes = 20);
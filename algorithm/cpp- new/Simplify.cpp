@@ -0,0 +1,78 @@
+#include "Simplify.h"
+#include <algorithm>
+#include <utility>
+
+long long SimplifyPolyline(std::span<const double> xy, double tolerance, std::vector<double>& out)
+{
+    const int n = (int)xy.size() / 2;
+    out.clear();
+    if (n <= 2 || tolerance <= 0)
+    {
+        out.assign(xy.begin(), xy.end());
+        return 0;
+    }
+
+    const double tolerance2 = tolerance * tolerance;
+    std::vector<char> keep(n);
+    keep[0] = keep[n - 1] = 1;
+    std::vector<std::pair<int, int>> spans{{0, n - 1}};
+    long long distances = 0;
+    while (!spans.empty())
+    {
+        auto [a, b] = spans.back();
+        spans.pop_back();
+        if (b - a < 2)
+            continue;
+        distances += b - a - 1;
+        // farthest vertex from the segment a-b (a closed loop's a == b measures to the point)
+        const double ax = xy[2 * a], ay = xy[2 * a + 1];
+        const double dx = xy[2 * b] - ax, dy = xy[2 * b + 1] - ay;
+        const double len2 = dx * dx + dy * dy;
+        int far = -1;
+        double far_d2 = tolerance2;
+        for (int i = a + 1; i < b; i++)
+        {
+            double px = xy[2 * i] - ax, py = xy[2 * i + 1] - ay;
+            double t = len2 > 0 ? std::clamp((px * dx + py * dy) / len2, 0.0, 1.0) : 0;
+            double ex = px - t * dx, ey = py - t * dy;
+            double d2 = ex * ex + ey * ey;
+            if (d2 > far_d2)
+            {
+                far_d2 = d2;
+                far = i;
+            }
+        }
+        if (far < 0)
+            continue;
+        keep[far] = 1;
+        spans.emplace_back(a, far);
+        spans.emplace_back(far, b);
+    }
+
+    for (int i = 0; i < n; i++)
+    {
+        if (!keep[i])
+            continue;
+        out.push_back(xy[2 * i]);
+        out.push_back(xy[2 * i + 1]);
+    }
+    return distances;
+}
+
+int SimplifyPolylines(PolylineSet& paths, double tolerance)
+{
+    if (tolerance <= 0)
+        return 0;
+    const int before = (int)paths.xy.size() / 2;
+    PolylineSet simplified;
+    simplified.xy.reserve(paths.xy.size());
+    simplified.starts.reserve(paths.starts.size());
+    std::vector<double> out;
+    for (int k = 0; k < paths.Count(); k++)
+    {
+        SimplifyPolyline(paths[k], tolerance, out);
+        simplified.Add(out);
+    }
+    paths = std::move(simplified);
+    return before - (int)paths.xy.size() / 2;
+}
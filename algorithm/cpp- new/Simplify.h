@@ -0,0 +1,15 @@
+#pragma once
+#include "TemplateWriter.h"
+
+// Douglas-Peucker simplification of a polyline (x, y pairs) into out: keeps the endpoints and
+// drops every vertex the kept ones follow within tolerance (same units as xy, measured to the
+// kept segments). The spans still to split sit on an explicit stack, so long chains cannot
+// overflow the call stack. Each span costs one distance per vertex inside it, so the run is
+// O(n log n) when the farthest vertex splits spans near their middle, as on the smooth strip
+// chains, and O(n^2) when it keeps landing next to an end (e.g. a zigzag of shrinking
+// amplitude). Returns the number of distances evaluated (see test_SimplifyPolyline).
+long long SimplifyPolyline(std::span<const double> xy, double tolerance, std::vector<double>& out);
+
+// Simplifies each polyline on its own, so separate chains (such as the strip's two boundary
+// chains) stay separate and keep their endpoints. Returns the number of points removed.
+int SimplifyPolylines(PolylineSet& paths, double tolerance);
@@ -0,0 +1,254 @@
+#include "ThroatUnwrap.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__AVX512F__) || (defined(__AVX2__) && defined(__FMA__))
+#include <immintrin.h>
+#endif
+
+// Vector width of the batched spiral kernel; picked at compile time from the target flags
+// (-march=native / THROAT_UNWRAP_SIMD). Without AVX2+FMA the scalar loops below are used.
+#if defined(__AVX512F__)
+#define SPIRAL_LANES 8
+#elif defined(__AVX2__) && defined(__FMA__)
+#define SPIRAL_LANES 4
+#else
+#define SPIRAL_LANES 1
+#endif
+
+int SpiralBatchLanes()
+{
+    return SPIRAL_LANES;
+}
+
+#if SPIRAL_LANES > 1
+
+typedef double vdouble __attribute__((vector_size(SPIRAL_LANES * 8)));
+typedef long long vint64 __attribute__((vector_size(SPIRAL_LANES * 8)));
+typedef unsigned long long vuint64 __attribute__((vector_size(SPIRAL_LANES * 8)));
+
+static inline vdouble Fma(vdouble a, vdouble b, vdouble c)
+{
+#if SPIRAL_LANES == 8
+    return (vdouble)_mm512_fmadd_pd((__m512d)a, (__m512d)b, (__m512d)c);
+#else
+    return (vdouble)_mm256_fmadd_pd((__m256d)a, (__m256d)b, (__m256d)c);
+#endif
+}
+
+static inline vdouble Load(const double* p)
+{
+    vdouble v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+// round to nearest integer (|x| < 2^51); the integer is also returned in the low mantissa bits
+static inline vdouble Round(vdouble x, vint64& bits)
+{
+    const vdouble magic = vdouble{} + 0x1.8p52;
+    vdouble t = x + magic;
+    bits = (vint64)t - (vint64)magic;
+    return t - magic;
+}
+
+// sin and cos together: Cody-Waite reduction by pi/2 (two-term, fused) and the Cephes
+// minimax polynomials on [-pi/4, pi/4]; about 1 ulp for the |theta| range of our spirals
+static inline void SinCos(vdouble x, vdouble& s, vdouble& c)
+{
+    vint64 q;
+    vdouble n = Round(x * (2 / M_PI), q);
+    vdouble r = Fma(n, vdouble{} - 1.5707963267948966, x);
+    r = Fma(n, vdouble{} - 6.123233995736766e-17, r);
+    vdouble z = r * r;
+
+    vdouble ps = vdouble{} + 1.58962301576546568060E-10;
+    ps = Fma(ps, z, vdouble{} - 2.50507477628578072866E-8);
+    ps = Fma(ps, z, vdouble{} + 2.75573136213857245213E-6);
+    ps = Fma(ps, z, vdouble{} - 1.98412698295895385996E-4);
+    ps = Fma(ps, z, vdouble{} + 8.33333333332211858878E-3);
+    ps = Fma(ps, z, vdouble{} - 1.66666666666666307295E-1);
+    vdouble sr = Fma(ps * z, r, r);
+
+    vdouble pc = vdouble{} - 1.13585365213876817300E-11;
+    pc = Fma(pc, z, vdouble{} + 2.08757008419747316778E-9);
+    pc = Fma(pc, z, vdouble{} - 2.75573141792967388112E-7);
+    pc = Fma(pc, z, vdouble{} + 2.48015872888517045348E-5);
+    pc = Fma(pc, z, vdouble{} - 1.38888888888730564116E-3);
+    pc = Fma(pc, z, vdouble{} + 4.16666666666665929218E-2);
+    vdouble cr = Fma(pc * z, z, Fma(z, vdouble{} - 0.5, vdouble{} + 1.0));
+
+    // quadrant: odd quadrants swap sin/cos, quadrants 2,3 negate sin and 1,2 negate cos
+    vint64 swap = (q & 1) != 0;
+    vdouble sv = swap ? cr : sr;
+    vdouble cv = swap ? sr : cr;
+    vuint64 sneg = (vuint64)(q & 2) << 62;
+    vuint64 cneg = (vuint64)((q + 1) & 2) << 62;
+    s = (vdouble)((vuint64)sv ^ sneg);
+    c = (vdouble)((vuint64)cv ^ cneg);
+}
+
+// exp: reduction by ln2 (two-term, fused), degree-13 Taylor polynomial on [-ln2/2, ln2/2]
+// and scaling by 2^n through the exponent bits
+static inline vdouble Exp(vdouble x)
+{
+    x = x < -708.0 ? vdouble{} - 708.0 : x;
+    x = x > 709.0 ? vdouble{} + 709.0 : x;
+    vint64 k;
+    vdouble n = Round(x * M_LOG2E, k);
+    vdouble r = Fma(n, vdouble{} - 6.93147180369123816490e-01, x);
+    r = Fma(n, vdouble{} - 1.90821492927058770002e-10, r);
+
+    vdouble p = vdouble{} + 1.0 / 6227020800.0;
+    p = Fma(p, r, vdouble{} + 1.0 / 479001600.0);
+    p = Fma(p, r, vdouble{} + 1.0 / 39916800.0);
+    p = Fma(p, r, vdouble{} + 1.0 / 3628800.0);
+    p = Fma(p, r, vdouble{} + 1.0 / 362880.0);
+    p = Fma(p, r, vdouble{} + 1.0 / 40320.0);
+    p = Fma(p, r, vdouble{} + 1.0 / 5040.0);
+    p = Fma(p, r, vdouble{} + 1.0 / 720.0);
+    p = Fma(p, r, vdouble{} + 1.0 / 120.0);
+    p = Fma(p, r, vdouble{} + 1.0 / 24.0);
+    p = Fma(p, r, vdouble{} + 1.0 / 6.0);
+    p = Fma(p, r, vdouble{} + 0.5);
+    p = Fma(p, r, vdouble{} + 1.0);
+    p = Fma(p, r, vdouble{} + 1.0);
+
+    // 2^n split in two factors so n = -1022 .. 1023 stays representable
+    vint64 k1 = k >> 1;
+    vdouble s1 = (vdouble)((vuint64)(k1 + 1023) << 52);
+    vdouble s2 = (vdouble)((vuint64)(k - k1 + 1023) << 52);
+    return p * s1 * s2;
+}
+
+#endif
+
+// one instantiation per height function, so the sample loops carry no mode branch
+template <bool Equidistant>
+static void SampleOnSpiralKernel(const SpiralParams& spiral, std::span<const double> theta, std::span<double> x,
+                                 std::span<double> y, std::span<double> z, std::span<double> ch,
+                                 std::span<double> cr)
+{
+    const int n = (int)theta.size();
+    int i = 0;
+
+#if SPIRAL_LANES > 1
+    const double t = spiral.tan_cut, c1 = spiral.c1, c2_c1 = spiral.c2_c1;
+    const double r1 = spiral.r1, h = spiral.h, dr = spiral.dr_dh;
+    // the tail is padded to a full vector so every theta goes through the same kernel and the
+    // result for a theta never depends on its position in the span
+    for (; i < n; i += SPIRAL_LANES)
+    {
+        int m = std::min(SPIRAL_LANES, n - i);
+        double buf[SPIRAL_LANES];
+        for (int k = 0; k < SPIRAL_LANES; k++)
+            buf[k] = theta[i + std::min(k, m - 1)];
+
+        vdouble th = Load(buf);
+        vdouble vch;
+        if constexpr (Equidistant)
+            vch = t * th;
+        else
+            vch = c2_c1 - c2_c1 * Exp(-c1 * th);
+        vch = vch < 0.0 ? vdouble{} : vch;
+        vch = vch > h ? vdouble{} + h : vch;
+        vdouble vcr = r1 + dr * vch;
+        vdouble s, c;
+        SinCos(th, s, c);
+        vdouble vx = s * vcr;
+        vdouble vz = c * vcr;
+        for (int k = 0; k < m; k++)
+        {
+            x[i + k] = vx[k];
+            y[i + k] = vch[k];
+            z[i + k] = vz[k];
+            ch[i + k] = vch[k];
+            cr[i + k] = vcr[k];
+        }
+    }
+#endif
+
+    // scalar path (builds without SIMD): the per-sample template, so bit-identical to SampleOnSpiral
+    for (int j = i; j < n; j++)
+    {
+        Eigen::Vector3d p = SampleOnSpiral<Equidistant>(spiral, theta[j], ch[j], cr[j]);
+        x[j] = p.x();
+        y[j] = p.y();
+        z[j] = p.z();
+    }
+}
+
+void SampleOnSpiralBatch(const SpiralParams& spiral, std::span<const double> theta, std::span<double> x,
+                         std::span<double> y, std::span<double> z, std::span<double> ch, std::span<double> cr)
+{
+    if (spiral.equidistant)
+        SampleOnSpiralKernel<true>(spiral, theta, x, y, z, ch, cr);
+    else
+        SampleOnSpiralKernel<false>(spiral, theta, x, y, z, ch, cr);
+}
+
+void SampleOnSpiralBatch(double r1, double r2, double h, double cut_angle, bool equidistant,
+                         std::span<const double> theta, std::span<double> x, std::span<double> y,
+                         std::span<double> z, std::span<double> ch, std::span<double> cr)
+{
+    SampleOnSpiralBatch(SpiralParams(r1, r2, h, cut_angle, equidistant), theta, x, y, z, ch, cr);
+}
+
+// one instantiation per height function as for the batch kernel; the equidistant one has no
+// exp(-c1 * theta) to carry along
+template <bool Equidistant>
+static void SampleOnSpiralRecurrenceKernel(const SpiralParams& spiral, double theta0, double dtheta,
+                                           std::span<double> x, std::span<double> y, std::span<double> z,
+                                           std::span<double> ch, std::span<double> cr, int anchor)
+{
+    const int n = (int)x.size();
+    const double rc = cos(dtheta), rs = sin(dtheta);
+    const double ratio = Equidistant ? 1.0 : exp(-spiral.c1 * dtheta);
+    double c = 0, s = 0, e = 0;
+    for (int k = 0; k < n; k++)
+    {
+        double theta = theta0 + k * dtheta;
+        if (k % anchor == 0)
+        {
+            c = cos(theta);
+            s = sin(theta);
+            if constexpr (!Equidistant)
+                e = exp(-spiral.c1 * theta);
+        }
+        else
+        {
+            double cn = c * rc - s * rs;
+            s = s * rc + c * rs;
+            c = cn;
+            if constexpr (!Equidistant)
+                e *= ratio;
+        }
+
+        double v;
+        if constexpr (Equidistant)
+            v = spiral.tan_cut * theta;
+        else
+            v = spiral.c2_c1 - spiral.c2_c1 * e;
+        if (v < 0)
+            v = 0;
+        else if (v > spiral.h)
+            v = spiral.h;
+        ch[k] = v;
+        cr[k] = spiral.r1 + spiral.dr_dh * v;
+        x[k] = s * cr[k];
+        y[k] = v;
+        z[k] = c * cr[k];
+    }
+}
+
+void SampleOnSpiralRecurrence(const SpiralParams& spiral, double theta0, double dtheta, std::span<double> x,
+                              std::span<double> y, std::span<double> z, std::span<double> ch,
+                              std::span<double> cr, int anchor)
+{
+    anchor = std::max(1, anchor);
+    if (spiral.equidistant)
+        SampleOnSpiralRecurrenceKernel<true>(spiral, theta0, dtheta, x, y, z, ch, cr, anchor);
+    else
+        SampleOnSpiralRecurrenceKernel<false>(spiral, theta0, dtheta, x, y, z, ch, cr, anchor);
+}
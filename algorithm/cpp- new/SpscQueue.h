@@ -0,0 +1,80 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+// Bounded lock-free single-producer / single-consumer queue of preallocated slots. Items are
+// filled and read in place (WriteSlot/Push, ReadSlot/Pop), so buffers inside T are reused
+// instead of reallocated per item. Waiting sides yield the thread. Cancel stops both sides, e.g.
+// when one of them fails: their waiting and later WriteSlot / ReadSlot calls return nullptr.
+template <typename T>
+class SpscQueue
+{
+public:
+    explicit SpscQueue(int capacity) : slots(capacity) {}
+
+    // producer: next free slot, waiting while the queue is full; nullptr once cancelled
+    T* WriteSlot()
+    {
+        size_t t = tail.load(std::memory_order_relaxed);
+        while (t - head.load(std::memory_order_acquire) == slots.size())
+        {
+            if (cancelled.load(std::memory_order_acquire))
+                return nullptr;
+            std::this_thread::yield();
+        }
+        if (cancelled.load(std::memory_order_acquire))
+            return nullptr;
+        return &slots[t % slots.size()];
+    }
+
+    // producer: publishes the slot returned by WriteSlot
+    void Push()
+    {
+        tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // producer: no more items
+    void Close()
+    {
+        closed.store(true, std::memory_order_release);
+    }
+
+    // consumer: next filled slot, waiting while the queue is empty; nullptr once closed and
+    // drained, or cancelled
+    T* ReadSlot()
+    {
+        size_t h = head.load(std::memory_order_relaxed);
+        while (h == tail.load(std::memory_order_acquire))
+        {
+            if (closed.load(std::memory_order_acquire) && h == tail.load(std::memory_order_acquire))
+                return nullptr;
+            if (cancelled.load(std::memory_order_acquire))
+                return nullptr;
+            std::this_thread::yield();
+        }
+        if (cancelled.load(std::memory_order_acquire))
+            return nullptr;
+        return &slots[h % slots.size()];
+    }
+
+    // either side: gives up on the remaining items
+    void Cancel()
+    {
+        cancelled.store(true, std::memory_order_release);
+    }
+
+    // consumer: releases the slot returned by ReadSlot
+    void Pop()
+    {
+        head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+private:
+    std::vector<T> slots;
+    alignas(64) std::atomic<size_t> head{0}; // next slot to read
+    alignas(64) std::atomic<size_t> tail{0}; // next slot to write
+    alignas(64) std::atomic<bool> closed{false};
+    std::atomic<bool> cancelled{false};
+};
@@ -0,0 +1,674 @@
+#include "TemplateWriter.h"
+#include <algorithm>
+#include <charconv>
+#include <cctype>
+#include <cstring>
+#include <zlib.h>
+
+OutputBuffer::OutputBuffer(std::function<void(std::string_view)> sink, int precision, size_t capacity)
+    : sink(std::move(sink)), precision(std::clamp(precision, 0, 17)), capacity(std::max<size_t>(capacity, 4096))
+{
+    buffer.resize(this->capacity + 512);
+}
+
+OutputBuffer::OutputBuffer(std::FILE* file, int precision, size_t capacity)
+    : OutputBuffer(file ? std::function<void(std::string_view)>([file](std::string_view data)
+                          { fwrite(data.data(), 1, data.size(), file); })
+                        : nullptr,
+                   precision, capacity)
+{
+}
+
+OutputBuffer::~OutputBuffer()
+{
+    Flush();
+}
+
+char* OutputBuffer::Reserve(size_t n)
+{
+    if (size + n > buffer.size())
+    {
+        if (sink)
+            Flush();
+        if (size + n > buffer.size())
+            buffer.resize(std::max(2 * buffer.size(), size + n));
+    }
+    return buffer.data() + size;
+}
+
+OutputBuffer& OutputBuffer::Append(std::string_view s)
+{
+    memcpy(Reserve(s.size()), s.data(), s.size());
+    size += s.size();
+    if (sink && size >= capacity)
+        Flush();
+    return *this;
+}
+
+OutputBuffer& OutputBuffer::Append(char c)
+{
+    *Reserve(1) = c;
+    size++;
+    return *this;
+}
+
+OutputBuffer& OutputBuffer::Number(double v)
+{
+    // fixed notation of any finite double fits in 309 integer digits + sign, point and 17 decimals
+    char* first = Reserve(340);
+    char* last = std::to_chars(first, first + 340, v, std::chars_format::fixed, precision).ptr;
+    if (precision > 0 && std::find(first, last, '.') != last)
+    {
+        while (last[-1] == '0')
+            last--;
+        if (last[-1] == '.')
+            last--;
+    }
+    // values that round to zero print as 0, not -0
+    if (last - first == 2 && first[0] == '-' && first[1] == '0')
+    {
+        first[0] = '0';
+        last--;
+    }
+    size += last - first;
+    if (sink && size >= capacity)
+        Flush();
+    return *this;
+}
+
+OutputBuffer& OutputBuffer::Integer(long long v)
+{
+    char* first = Reserve(24);
+    size += std::to_chars(first, first + 24, v).ptr - first;
+    return *this;
+}
+
+void OutputBuffer::Flush()
+{
+    if (!sink || size == 0)
+        return;
+    sink(Data());
+    size = 0;
+}
+
+void BuildPolylines(const std::vector<int>& edges, int nvertices, std::vector<int>& vertices,
+                    std::vector<int>& starts)
+{
+    const int nedges = (int)edges.size() / 2;
+    vertices.clear();
+    starts.assign(1, 0);
+
+    // incident edges of each vertex (CSR)
+    std::vector<int> first(nvertices + 1, 0), incident(2 * nedges);
+    for (int i = 0; i < 2 * nedges; i++)
+        first[edges[i] + 1]++;
+    for (int v = 0; v < nvertices; v++)
+        first[v + 1] += first[v];
+    std::vector<int> fill(first.begin(), first.end() - 1);
+    for (int i = 0; i < 2 * nedges; i++)
+        incident[fill[edges[i]]++] = i / 2;
+
+    std::vector<char> used(nedges, 0);
+    auto degree = [&](int v) { return first[v + 1] - first[v]; };
+    auto next_edge = [&](int v)
+    {
+        for (int k = first[v]; k < first[v + 1]; k++)
+            if (!used[incident[k]])
+                return incident[k];
+        return -1;
+    };
+    auto walk = [&](int v, int e)
+    {
+        vertices.push_back(v);
+        while (e >= 0)
+        {
+            used[e] = 1;
+            v = edges[2 * e] == v ? edges[2 * e + 1] : edges[2 * e];
+            vertices.push_back(v);
+            e = degree(v) == 2 ? next_edge(v) : -1;
+        }
+        starts.push_back((int)vertices.size());
+    };
+
+    // open chains start at their ends, then what is left are closed loops
+    for (int v = 0; v < nvertices; v++)
+        if (degree(v) != 2)
+            for (int e = next_edge(v); e >= 0; e = next_edge(v))
+                walk(v, e);
+    for (int e = 0; e < nedges; e++)
+        if (!used[e])
+            walk(edges[2 * e], e);
+}
+
+PolylineJoiner::PolylineJoiner(std::function<void(std::span<const double>)> emit, int max_open, int max_points)
+    : emit(std::move(emit)), max_open(std::max(1, max_open)), max_points(std::max(2, max_points))
+{
+}
+
+PolylineJoiner::~PolylineJoiner()
+{
+    Flush();
+}
+
+void PolylineJoiner::Segment(double x0, double y0, double x1, double y1)
+{
+    for (auto& xy : open)
+    {
+        if (!xy.empty() && xy[xy.size() - 2] == x0 && xy.back() == y0)
+        {
+            xy.push_back(x1);
+            xy.push_back(y1);
+            if ((int)xy.size() >= 2 * max_points)
+            {
+                emit(xy);
+                xy.clear();
+            }
+            return;
+        }
+    }
+
+    // reuse an emptied slot, else evict round-robin
+    std::vector<double>* slot = nullptr;
+    for (auto& xy : open)
+        if (xy.empty())
+            slot = &xy;
+    if (!slot && (int)open.size() < max_open)
+        slot = &open.emplace_back();
+    if (!slot)
+    {
+        slot = &open[next_evict];
+        next_evict = (next_evict + 1) % max_open;
+        emit(*slot);
+        slot->clear();
+    }
+    slot->insert(slot->end(), {x0, y0, x1, y1});
+}
+
+void PolylineJoiner::Flush()
+{
+    for (auto& xy : open)
+    {
+        if (!xy.empty())
+            emit(xy);
+        xy.clear();
+    }
+}
+
+PageDimensions GetPageDimensions(PageSize size, bool landscape)
+{
+    PageDimensions page;
+    switch (size)
+    {
+    case PageSize::A3:
+        page = {297, 420, 842, 1191};
+        break;
+    case PageSize::Letter:
+        page = {215.9, 279.4, 612, 792};
+        break;
+    case PageSize::Legal:
+        page = {215.9, 355.6, 612, 1008};
+        break;
+    default:
+        page = {210, 297, 595, 842};
+        break;
+    }
+    if (landscape)
+    {
+        std::swap(page.width_mm, page.height_mm);
+        std::swap(page.width_pt, page.height_pt);
+    }
+    return page;
+}
+
+bool ParsePageSize(const char* name, PageSize& size)
+{
+    std::string s(name);
+    std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+    if (s == "a4")
+        size = PageSize::A4;
+    else if (s == "a3")
+        size = PageSize::A3;
+    else if (s == "letter")
+        size = PageSize::Letter;
+    else if (s == "legal")
+        size = PageSize::Legal;
+    else
+        return false;
+    return true;
+}
+
+static bool HasExtension(const std::string& path, const char* ext)
+{
+    size_t n = strlen(ext);
+    if (path.size() < n)
+        return false;
+    for (size_t i = 0; i < n; i++)
+        if (std::tolower((unsigned char)path[path.size() - n + i]) != ext[i])
+            return false;
+    return true;
+}
+
+std::unique_ptr<PathWriter> OpenPathWriter(const std::string& path, const PageDimensions& page, int precision)
+{
+    if (HasExtension(path, ".pdf"))
+        return std::make_unique<PdfWriter>(path, page.width_pt, page.height_pt, precision);
+    if (HasExtension(path, ".svg"))
+        return std::make_unique<SvgWriter>(path, page, precision);
+    if (HasExtension(path, ".dxf"))
+        return std::make_unique<DxfWriter>(path, page, precision);
+    return std::make_unique<PostScriptWriter>(path, page.width_pt, page.height_pt, precision);
+}
+
+bool WritesPageFiles(const std::string& path)
+{
+    return HasExtension(path, ".svg") || HasExtension(path, ".dxf");
+}
+
+void PathWriter::Bezier(std::span<const double> xy)
+{
+    // 16 chords per cubic keep a curve that turns by 90 degrees within 0.1% of its radius
+    const int steps = 16;
+    if (xy.size() < 8)
+        return;
+    std::vector<double> flat{xy[0], xy[1]};
+    for (size_t i = 2; i + 5 < xy.size(); i += 6)
+    {
+        const double* c = &xy[i - 2];
+        for (int k = 1; k <= steps; k++)
+        {
+            double t = (double)k / steps, s = 1 - t;
+            double b0 = s * s * s, b1 = 3 * s * s * t, b2 = 3 * s * t * t, b3 = t * t * t;
+            flat.push_back(b0 * c[0] + b1 * c[2] + b2 * c[4] + b3 * c[6]);
+            flat.push_back(b0 * c[1] + b1 * c[3] + b2 * c[5] + b3 * c[7]);
+        }
+    }
+    Polyline(flat);
+}
+
+PostScriptWriter::PostScriptWriter(const std::string& path, double width_pt, double height_pt, int precision)
+    : file(fopen(path.c_str(), "wb")), out(file, precision)
+{
+    if (!file)
+        return;
+    out.Append("%!PS\n<< /PageSize [").Number(width_pt).Append(' ').Number(height_pt).Append("] >> setpagedevice\n");
+}
+
+PostScriptWriter::~PostScriptWriter()
+{
+    Finish();
+}
+
+void PostScriptWriter::Polyline(std::span<const double> xy)
+{
+    // moveto/lineto only: the paths are open, closepath would retrace the first segment
+    if (!file || xy.size() < 4)
+        return;
+    out.Number(xy[0]).Append(' ').Number(xy[1]).Append(" moveto\n");
+    for (size_t i = 2; i < xy.size(); i += 2)
+        out.Number(xy[i]).Append(' ').Number(xy[i + 1]).Append(" lineto\n");
+}
+
+void PostScriptWriter::Bezier(std::span<const double> xy)
+{
+    if (!file || xy.size() < 8)
+        return;
+    out.Number(xy[0]).Append(' ').Number(xy[1]).Append(" moveto\n");
+    for (size_t i = 2; i + 5 < xy.size(); i += 6)
+    {
+        for (int k = 0; k < 6; k++)
+            out.Number(xy[i + k]).Append(' ');
+        out.Append("curveto\n");
+    }
+}
+
+void PostScriptWriter::NewPage()
+{
+    if (!file)
+        return;
+    out.Append("0 setlinewidth stroke\n");
+    out.Append("showpage\n");
+}
+
+void PostScriptWriter::Finish()
+{
+    if (!file)
+        return;
+    NewPage();
+    out.Flush();
+    fclose(file);
+    file = nullptr;
+}
+
+PdfWriter::PdfWriter(const std::string& path, double width_pt, double height_pt, int precision)
+    : file(fopen(path.c_str(), "wb")), width_pt(width_pt), height_pt(height_pt),
+      out([this](std::string_view data) { Deflate(data, Z_NO_FLUSH); }, precision), zs(new z_stream_s()),
+      zbuf(1 << 16), objects(2, 0)
+{
+    if (!file)
+        return;
+    // level 1: the coordinate text already deflates ~6x there, at a quarter of the default's time
+    if (deflateInit(zs.get(), Z_BEST_SPEED) != Z_OK)
+    {
+        fclose(file);
+        file = nullptr;
+        return;
+    }
+    // objects 1 (catalog) and 2 (page tree) are written last, when the pages are known
+    Raw("%PDF-1.4\n%\xE2\xE3\xCF\xD3\n");
+}
+
+PdfWriter::~PdfWriter()
+{
+    Finish();
+}
+
+void PdfWriter::Raw(std::string_view s)
+{
+    fwrite(s.data(), 1, s.size(), file);
+    offset += s.size();
+}
+
+int PdfWriter::BeginObject()
+{
+    objects.push_back(offset);
+    int id = (int)objects.size();
+    Raw(std::to_string(id) + " 0 obj\n");
+    return id;
+}
+
+void PdfWriter::Deflate(std::string_view data, int flush)
+{
+    zs->next_in = (Bytef*)data.data();
+    zs->avail_in = (uInt)data.size();
+    int ret;
+    do
+    {
+        zs->next_out = zbuf.data();
+        zs->avail_out = (uInt)zbuf.size();
+        ret = deflate(zs.get(), flush);
+        size_t n = zbuf.size() - zs->avail_out;
+        fwrite(zbuf.data(), 1, n, file);
+        offset += n;
+    } while (zs->avail_out == 0 || (flush == Z_FINISH && ret != Z_STREAM_END));
+}
+
+void PdfWriter::BeginPage()
+{
+    // content stream; its length goes into the object right after it
+    int content = BeginObject();
+    length_object = content + 1;
+    Raw("<< /Length " + std::to_string(length_object) + " 0 R /Filter /FlateDecode >>\nstream\n");
+    stream_start = offset;
+    deflateReset(zs.get());
+    page_open = true;
+    out.Append("0 w\n");
+}
+
+void PdfWriter::EndPage()
+{
+    out.Flush();
+    Deflate({}, Z_FINISH);
+    long long length = offset - stream_start;
+    Raw("\nendstream\nendobj\n");
+    int content = length_object - 1;
+    BeginObject();
+    Raw(std::to_string(length) + "\nendobj\n");
+
+    OutputBuffer page;
+    page.Append("<< /Type /Page /Parent 2 0 R /MediaBox [0 0 ").Number(width_pt).Append(' ').Number(height_pt);
+    page.Append("] /Contents ").Integer(content).Append(" 0 R >>\nendobj\n");
+    page_objects.push_back(BeginObject());
+    Raw(page.Data());
+    page_open = false;
+}
+
+void PdfWriter::Polyline(std::span<const double> xy)
+{
+    if (!file || xy.size() < 4)
+        return;
+    if (!page_open)
+        BeginPage();
+    out.Number(xy[0]).Append(' ').Number(xy[1]).Append(" m\n");
+    for (size_t i = 2; i < xy.size(); i += 2)
+        out.Number(xy[i]).Append(' ').Number(xy[i + 1]).Append(" l\n");
+    out.Append("S\n");
+}
+
+void PdfWriter::Bezier(std::span<const double> xy)
+{
+    if (!file || xy.size() < 8)
+        return;
+    if (!page_open)
+        BeginPage();
+    out.Number(xy[0]).Append(' ').Number(xy[1]).Append(" m\n");
+    for (size_t i = 2; i + 5 < xy.size(); i += 6)
+    {
+        for (int k = 0; k < 6; k++)
+            out.Number(xy[i + k]).Append(' ');
+        out.Append("c\n");
+    }
+    out.Append("S\n");
+}
+
+void PdfWriter::NewPage()
+{
+    if (!file)
+        return;
+    if (!page_open)
+        BeginPage();
+    EndPage();
+}
+
+void PdfWriter::Finish()
+{
+    if (!file)
+        return;
+    if (!page_open)
+        BeginPage();
+    EndPage();
+
+    objects[0] = offset;
+    Raw("1 0 obj\n<< /Type /Catalog /Pages 2 0 R >>\nendobj\n");
+    objects[1] = offset;
+    std::string kids;
+    for (int id : page_objects)
+        kids += std::to_string(id) + " 0 R ";
+    Raw("2 0 obj\n<< /Type /Pages /Kids [ " + kids + "] /Count " + std::to_string(page_objects.size()) +
+        " >>\nendobj\n");
+
+    long long xref = offset;
+    Raw("xref\n0 " + std::to_string(objects.size() + 1) + "\n0000000000 65535 f \n");
+    char entry[32];
+    for (long long at : objects)
+    {
+        snprintf(entry, sizeof(entry), "%010lld 00000 n \n", at);
+        Raw(entry);
+    }
+    Raw("trailer\n<< /Size " + std::to_string(objects.size() + 1) + " /Root 1 0 R >>\nstartxref\n" +
+        std::to_string(xref) + "\n%%EOF\n");
+
+    deflateEnd(zs.get());
+    fclose(file);
+    file = nullptr;
+}
+
+std::string PageFilePath(const std::string& path, int page)
+{
+    if (page <= 1)
+        return path;
+    size_t dot = path.find_last_of('.');
+    size_t slash = path.find_last_of("/\\");
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+        dot = path.size();
+    return path.substr(0, dot) + "_" + std::to_string(page) + path.substr(dot);
+}
+
+// Files are written through out, which owns no FILE*: the sink writes to whichever page file
+// is open
+static std::function<void(std::string_view)> FileSink(std::FILE*& file)
+{
+    return [&file](std::string_view data) { fwrite(data.data(), 1, data.size(), file); };
+}
+
+SvgWriter::SvgWriter(const std::string& path, const PageDimensions& page, int precision)
+    : path(path), page(page), mm_per_pt_x(page.width_mm / page.width_pt), mm_per_pt_y(page.height_mm / page.height_pt),
+      out(FileSink(file), precision)
+{
+    BeginFile();
+    ok = file != nullptr;
+}
+
+SvgWriter::~SvgWriter()
+{
+    Finish();
+}
+
+void SvgWriter::BeginFile()
+{
+    file = fopen(PageFilePath(path, page_index).c_str(), "wb");
+    if (!file)
+        return;
+    out.Append("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
+    out.Append("<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"").Number(page.width_mm).Append("mm\" height=\"");
+    out.Number(page.height_mm).Append("mm\" viewBox=\"0 0 ").Number(page.width_mm).Append(' ').Number(page.height_mm);
+    out.Append("\">\n<g id=\"cut\" fill=\"none\" stroke=\"#000\" stroke-width=\"0.025\">\n");
+    in_marks = false;
+}
+
+void SvgWriter::EndFile()
+{
+    if (!file)
+        return;
+    out.Append("</g>\n</svg>\n");
+    out.Flush();
+    fclose(file);
+    file = nullptr;
+}
+
+void SvgWriter::Group(bool marks)
+{
+    if (marks == in_marks)
+        return;
+    out.Append("</g>\n<g id=\"").Append(marks ? "marks" : "cut");
+    out.Append("\" fill=\"none\" stroke=\"#000\" stroke-width=\"0.025\">\n");
+    in_marks = marks;
+}
+
+void SvgWriter::Path(std::span<const double> xy, const char* command)
+{
+    // SVG's y axis points down
+    out.Append("<path d=\"M");
+    for (size_t i = 0; i + 1 < xy.size(); i += 2)
+    {
+        if (i == 2)
+            out.Append(command);
+        out.Append(' ').Number(xy[i] * mm_per_pt_x).Append(' ').Number(page.height_mm - xy[i + 1] * mm_per_pt_y);
+    }
+    out.Append("\"/>\n");
+}
+
+void SvgWriter::Polyline(std::span<const double> xy)
+{
+    if (!file || xy.size() < 4)
+        return;
+    Group(false);
+    Path(xy, " L");
+}
+
+void SvgWriter::Bezier(std::span<const double> xy)
+{
+    if (!file || xy.size() < 8)
+        return;
+    Group(false);
+    Path(xy, " C");
+}
+
+void SvgWriter::Mark(std::span<const double> xy)
+{
+    if (!file || xy.size() < 4)
+        return;
+    Group(true);
+    Path(xy, " L");
+}
+
+void SvgWriter::NewPage()
+{
+    if (!file)
+        return;
+    EndFile();
+    page_index++;
+    BeginFile();
+    ok = file != nullptr;
+}
+
+void SvgWriter::Finish()
+{
+    EndFile();
+}
+
+DxfWriter::DxfWriter(const std::string& path, const PageDimensions& page, int precision)
+    : path(path), page(page), mm_per_pt_x(page.width_mm / page.width_pt), mm_per_pt_y(page.height_mm / page.height_pt),
+      out(FileSink(file), precision)
+{
+    BeginFile();
+    ok = file != nullptr;
+}
+
+DxfWriter::~DxfWriter()
+{
+    Finish();
+}
+
+void DxfWriter::BeginFile()
+{
+    file = fopen(PageFilePath(path, page_index).c_str(), "wb");
+    if (!file)
+        return;
+    out.Append("0\nSECTION\n2\nHEADER\n9\n$ACADVER\n1\nAC1015\n9\n$INSUNITS\n70\n4\n");
+    out.Append("9\n$EXTMIN\n10\n0\n20\n0\n9\n$EXTMAX\n10\n").Number(page.width_mm).Append("\n20\n");
+    out.Number(page.height_mm).Append("\n0\nENDSEC\n0\nSECTION\n2\nENTITIES\n");
+}
+
+void DxfWriter::EndFile()
+{
+    if (!file)
+        return;
+    out.Append("0\nENDSEC\n0\nEOF\n");
+    out.Flush();
+    fclose(file);
+    file = nullptr;
+}
+
+void DxfWriter::Entity(std::span<const double> xy, const char* layer)
+{
+    if (!file || xy.size() < 4)
+        return;
+    out.Append("0\nLWPOLYLINE\n8\n").Append(layer).Append("\n90\n").Integer((long long)xy.size() / 2).Append("\n70\n0\n");
+    for (size_t i = 0; i < xy.size(); i += 2)
+        out.Append("10\n").Number(xy[i] * mm_per_pt_x).Append("\n20\n").Number(xy[i + 1] * mm_per_pt_y).Append('\n');
+}
+
+void DxfWriter::Polyline(std::span<const double> xy)
+{
+    Entity(xy, "CUT");
+}
+
+void DxfWriter::Mark(std::span<const double> xy)
+{
+    Entity(xy, "MARKS");
+}
+
+void DxfWriter::NewPage()
+{
+    if (!file)
+        return;
+    EndFile();
+    page_index++;
+    BeginFile();
+    ok = file != nullptr;
+}
+
+void DxfWriter::Finish()
+{
+    EndFile();
+}
@@ -0,0 +1,281 @@
+#pragma once
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct z_stream_s;
+
+// Text output assembled in a reusable buffer. Numbers are formatted with std::to_chars at a
+// fixed number of decimals (trailing zeros dropped). With a file or sink the buffer is handed
+// on in blocks of about capacity bytes; without either it only grows, for callers that
+// post-process it.
+class OutputBuffer
+{
+public:
+    explicit OutputBuffer(std::FILE* file = nullptr, int precision = 3, size_t capacity = 1 << 20);
+    OutputBuffer(std::function<void(std::string_view)> sink, int precision = 3, size_t capacity = 1 << 20);
+    ~OutputBuffer();
+    OutputBuffer(const OutputBuffer&) = delete;
+    OutputBuffer& operator=(const OutputBuffer&) = delete;
+
+    OutputBuffer& Append(std::string_view s);
+    OutputBuffer& Append(char c);
+    OutputBuffer& Number(double v);
+    OutputBuffer& Integer(long long v);
+
+    // hands the buffered text to the file or sink (no-op without one)
+    void Flush();
+
+    std::string_view Data() const { return std::string_view(buffer.data(), size); }
+    void Clear() { size = 0; }
+    int Precision() const { return precision; }
+
+private:
+    char* Reserve(size_t n);
+
+    std::function<void(std::string_view)> sink;
+    int precision;
+    size_t capacity;
+    std::vector<char> buffer;
+    size_t size = 0;
+};
+
+// Polylines in one x, y array: polyline k has the points [starts[k], starts[k+1])
+struct PolylineSet
+{
+    std::vector<double> xy;
+    std::vector<int> starts{0};
+
+    int Count() const { return (int)starts.size() - 1; }
+    int Points(int k) const { return starts[k + 1] - starts[k]; }
+    std::span<const double> operator[](int k) const
+    {
+        return std::span<const double>(xy.data() + 2 * starts[k], 2 * Points(k));
+    }
+    void Add(std::span<const double> points)
+    {
+        xy.insert(xy.end(), points.begin(), points.end());
+        starts.push_back((int)xy.size() / 2);
+    }
+    // starts an empty polyline; Append adds points to the last one
+    void NewPolyline() { starts.push_back(starts.back()); }
+    void Append(double x, double y)
+    {
+        xy.push_back(x);
+        xy.push_back(y);
+        starts.back()++;
+    }
+    void Clear()
+    {
+        xy.clear();
+        starts.assign(1, 0);
+    }
+};
+
+// Splits an edge list (pairs of vertex indices) into maximal polylines in O(edges + nvertices):
+// edges meeting at a vertex of degree 2 are joined, any other degree ends a polyline, and
+// closed loops start (and end) at the first vertex of their first edge. Polyline k has the
+// vertices [starts[k], starts[k+1]) of vertices; starts gets npolylines + 1 entries.
+void BuildPolylines(const std::vector<int>& edges, int nvertices, std::vector<int>& vertices,
+                    std::vector<int>& starts);
+
+// Streaming counterpart of BuildPolylines for segments given by coordinates: a segment that
+// starts exactly where an open polyline ends extends it. At most max_open polylines stay open
+// and one is handed to emit (as x, y pairs) once it reaches max_points points, so memory is
+// bounded; the next segment of that chain then starts a new polyline at the same point.
+class PolylineJoiner
+{
+public:
+    PolylineJoiner(std::function<void(std::span<const double>)> emit, int max_open = 8, int max_points = 4096);
+    ~PolylineJoiner();
+
+    void Segment(double x0, double y0, double x1, double y1);
+    // emits all open polylines
+    void Flush();
+
+private:
+    std::function<void(std::span<const double>)> emit;
+    int max_open, max_points;
+    std::vector<std::vector<double>> open;
+    int next_evict = 0;
+};
+
+// Paper sizes of the web front end's PAGE_DIMENSIONS (src/modules/pdf/constants.ts)
+enum class PageSize
+{
+    A4,
+    A3,
+    Letter,
+    Legal
+};
+
+struct PageDimensions
+{
+    double width_mm, height_mm;
+    double width_pt, height_pt;
+};
+
+// width and height are swapped for landscape
+PageDimensions GetPageDimensions(PageSize size, bool landscape = false);
+// "a4", "a3", "letter" or "legal" (case-insensitive); false for anything else
+bool ParsePageSize(const char* name, PageSize& size);
+
+// Output format of a cut template. Coordinates are in points with the origin at the bottom
+// left of the page; paths are stroked with a hairline.
+class PathWriter
+{
+public:
+    virtual ~PathWriter() = default;
+
+    // false if the output file could not be opened
+    virtual bool Ok() const = 0;
+    // xy holds x, y pairs
+    virtual void Polyline(std::span<const double> xy) = 0;
+    void Segment(double x0, double y0, double x1, double y1)
+    {
+        const double xy[4] = {x0, y0, x1, y1};
+        Polyline(xy);
+    }
+    // xy holds the start point, then control point 1, control point 2 and end point of each
+    // cubic (see FitCubicBeziers); formats without curves get them flattened into a polyline
+    virtual void Bezier(std::span<const double> xy);
+    // a printed guide that is not to be cut, e.g. a registration mark; formats for cutters keep
+    // these apart from the cut lines (SVG group "marks", DXF layer MARKS), the others stroke
+    // them like Polyline
+    virtual void Mark(std::span<const double> xy) { Polyline(xy); }
+    // ends the current page and starts another one
+    virtual void NewPage() = 0;
+    // ends the last page and closes the file; also done by the destructor
+    virtual void Finish() = 0;
+};
+
+// Opens a PdfWriter, SvgWriter or DxfWriter for paths ending in .pdf, .svg or .dxf and a
+// PostScriptWriter otherwise
+std::unique_ptr<PathWriter> OpenPathWriter(const std::string& path, const PageDimensions& page, int precision = 3);
+
+// True if OpenPathWriter writes one file per page for path (SVG and DXF, see PageFilePath)
+bool WritesPageFiles(const std::string& path);
+
+// PostScript cut template: one moveto/lineto... path per polyline, stroked once per page
+class PostScriptWriter : public PathWriter
+{
+public:
+    // opens path for writing and requests the page size from the device
+    PostScriptWriter(const std::string& path, double width_pt, double height_pt, int precision = 3);
+    ~PostScriptWriter() override;
+
+    bool Ok() const override { return file != nullptr; }
+    void Polyline(std::span<const double> xy) override;
+    void Bezier(std::span<const double> xy) override;
+    void NewPage() override;
+    void Finish() override;
+
+private:
+    std::FILE* file;
+    OutputBuffer out;
+};
+
+// PDF 1.4 cut template. Each page's content stream is deflated (zlib) while it is written, so
+// only one buffer block of uncompressed text is held at a time.
+class PdfWriter : public PathWriter
+{
+public:
+    PdfWriter(const std::string& path, double width_pt, double height_pt, int precision = 3);
+    ~PdfWriter() override;
+
+    bool Ok() const override { return file != nullptr; }
+    void Polyline(std::span<const double> xy) override;
+    void Bezier(std::span<const double> xy) override;
+    void NewPage() override;
+    void Finish() override;
+
+private:
+    void BeginPage();
+    void EndPage();
+    void Deflate(std::string_view data, int flush);
+    void Raw(std::string_view s);
+    int BeginObject();
+
+    std::FILE* file;
+    double width_pt, height_pt;
+    OutputBuffer out;                 // uncompressed page content
+    std::unique_ptr<z_stream_s> zs;
+    std::vector<unsigned char> zbuf;
+    long long offset = 0;             // bytes written to the file
+    long long stream_start = 0;
+    std::vector<long long> objects;   // file offset of object k + 1
+    std::vector<int> page_objects;
+    int length_object = 0;            // object holding the /Length of the current stream
+    bool page_open = false;
+};
+
+// SVG and DXF hold one page per file: page 1 goes to path and page k > 1 to path with "_k"
+// inserted before the extension
+std::string PageFilePath(const std::string& path, int page);
+
+// SVG cut template for laser cutters: one <path> per polyline, in true millimeters (the
+// points the CLI computes from template centimeters are scaled back by the page's mm/pt). Cut
+// lines go in the group "cut" and marks in the group "marks".
+class SvgWriter : public PathWriter
+{
+public:
+    SvgWriter(const std::string& path, const PageDimensions& page, int precision = 3);
+    ~SvgWriter() override;
+
+    bool Ok() const override { return ok; }
+    void Polyline(std::span<const double> xy) override;
+    void Bezier(std::span<const double> xy) override;
+    void Mark(std::span<const double> xy) override;
+    void NewPage() override;
+    void Finish() override;
+
+private:
+    void BeginFile();
+    void EndFile();
+    // closes the open group and opens "marks" or "cut" if the next path belongs to the other one
+    void Group(bool marks);
+    void Path(std::span<const double> xy, const char* command);
+
+    std::string path;
+    PageDimensions page;
+    double mm_per_pt_x, mm_per_pt_y;
+    int page_index = 1;
+    bool ok;
+    bool in_marks = false;
+    std::FILE* file = nullptr;
+    OutputBuffer out;
+};
+
+// DXF (AC1015) cut template for CNC drag knives: one LWPOLYLINE per polyline on layer CUT (marks
+// on layer MARKS), in millimeters ($INSUNITS 4). Only the HEADER and ENTITIES sections are
+// written, which CAM and cutter software accept; the coordinates are scaled like SvgWriter's.
+// Curves are flattened.
+class DxfWriter : public PathWriter
+{
+public:
+    DxfWriter(const std::string& path, const PageDimensions& page, int precision = 3);
+    ~DxfWriter() override;
+
+    bool Ok() const override { return ok; }
+    void Polyline(std::span<const double> xy) override;
+    void Mark(std::span<const double> xy) override;
+    void NewPage() override;
+    void Finish() override;
+
+private:
+    void BeginFile();
+    void EndFile();
+    void Entity(std::span<const double> xy, const char* layer);
+
+    std::string path;
+    PageDimensions page;
+    double mm_per_pt_x, mm_per_pt_y;
+    int page_index = 1;
+    bool ok;
+    std::FILE* file = nullptr;
+    OutputBuffer out;
+};
@@ -1,31 +1,93 @@
 #include "ThroatUnwrap.h"
+#include "Parallel.h"
+#include "SpscQueue.h"
 #include <Eigen/Core>
 #include <vector>
 #include <memory>
 #include <algorithm>
 #include <cstdlib>
 #include <iostream>
+#include <bit>
+#include <cstdint>
+#include <atomic>
+#include <functional>
+#include <chrono>
+#include <thread>
+#include <exception>
+
+SpiralParams::SpiralParams(double r1, double r2, double h, double cut_angle, bool equidistant)
+    : r1(r1), r2(r2), h(h), cut_angle(cut_angle), equidistant(equidistant)
+{
+    //solution to first-order ODE (using integrating factor)
+    tan_cut = tan(cut_angle);
+    c1 = -tan_cut * ((r2 - r1) / h);
+    c2 = tan_cut * r1;
+    c2_c1 = c2 / c1;
+    dr_dh = (r2 - r1) / h;
+}
 
 Eigen::Vector3d SampleOnSpiral(double r1, double r2, double h, double cut_angle,
                                double theta, double& ch, double& cr, bool equidistant)
 {
-    if (equidistant)
-        ch = tan(cut_angle) * theta; // h(theta)
-    else
+    return SampleOnSpiral(SpiralParams(r1, r2, h, cut_angle, equidistant), theta, ch, cr);
+}
+
+// Closed-form theta at which the unclamped spiral height reaches h (infinite if it never does)
+static double SpiralEndTheta(const SpiralParams& spiral)
+{
+    if (spiral.equidistant)
+        return spiral.h / spiral.tan_cut;
+
+    // invert ch(theta) = c2/c1 - c2/c1 * exp(-c1 * theta)
+    double arg = 1 - spiral.h / spiral.c2_c1;
+    if (!(arg > 0) || spiral.c1 == 0)
+        return INFINITY;
+    return -log(arg) / spiral.c1;
+}
+
+// First spiral step whose sample is clamped to h, or max_steps if there is none before it.
+// The closed-form end angle gives the step directly; the neighbouring samples are then checked
+// so the result agrees with SampleOnSpiral's rounding exactly.
+static int SpiralEndStep(const SpiralParams& spiral, int circle_res, int max_steps)
+{
+    auto clamped = [&](int id)
     {
-        //solution to first-order ODE (using integrating factor)
-        double c1 = -tan(cut_angle) * ((r2 - r1) / h);
-        double c2 = tan(cut_angle) * r1;
-        ch = c2 / c1 - c2 / c1 * exp(-c1 * theta);
-    }
+        double ch, cr;
+        SampleOnSpiral(spiral, -2 * M_PI + id * 2 * M_PI / circle_res, ch, cr);
+        return ch == spiral.h;
+    };
 
-    if (ch < 0)
-        ch = 0;
-    else if (ch > h)
-        ch = h;
-    cr = r1 + (r2 - r1) / h * ch; // r(h)
+    double steps = ceil((SpiralEndTheta(spiral) + 2 * M_PI) * circle_res / (2 * M_PI));
+    int id = max_steps;
+    if (steps < 0)
+        id = 0;
+    else if (steps < max_steps)
+        id = (int)steps;
 
-    return Eigen::Vector3d(sin(theta) * cr, ch, cos(theta) * cr);
+    while (id > 0 && clamped(id - 1))
+        id--;
+    while (id < max_steps && !clamped(id))
+        id++;
+    return id;
+}
+
+// Warns on log when the spiral never reaches h or needs more than maxiter samples at circle_res
+static void WarnSpiralBudget(const SpiralParams& spiral, int circle_res, int maxiter, std::ostream& log)
+{
+    double theta_end = SpiralEndTheta(spiral);
+    double required = ceil((theta_end + 2 * M_PI) * circle_res / (2 * M_PI)) + circle_res;
+    if (std::isinf(theta_end))
+    {
+        log << "[WARNING] Spiral never reaches h = " << spiral.h << " for r1 = " << spiral.r1 << ", r2 = "
+            << spiral.r2 << ", cut_angle = " << spiral.cut_angle << "; the mesh is truncated at " << maxiter
+            << " samples" << std::endl;
+    }
+    else if (required > maxiter)
+    {
+        log << "[WARNING] Spiral needs " << required << " samples (end angle " << theta_end
+            << " rad at circle_res " << circle_res << "), over the budget of " << maxiter
+            << "; the mesh is truncated" << std::endl;
+    }
 }
 
 void CreateCylinderWithCut(double r1, double r2, double h,
@@ -35,6 +97,17 @@ void CreateCylinderWithCut(double r1, double r2, double h,
                            int circle_res, double cut_angle, bool equidistant,
                            std::vector<int>& edges, std::vector<int>& corrs)
 {
+    CreateCylinderWithCut(SpiralParams(r1, r2, h, cut_angle, equidistant), V, F, P, circle_res, edges, corrs);
+}
+
+void CreateCylinderWithCut(const SpiralParams& spiral,
+                           Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>& V,
+                           Eigen::Matrix<int, Eigen::Dynamic, Eigen::Dynamic>& F,
+                           Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>& P,
+                           int circle_res, std::vector<int>& edges, [[maybe_unused]] std::vector<int>& corrs,
+                           SpiralSampling sampling, std::ostream& log)
+{
+    const double r1 = spiral.r1, r2 = spiral.r2, h = spiral.h, cut_angle = spiral.cut_angle;
     if (cut_angle == -1)
     {
         int nvertices = 2 * circle_res;
@@ -53,98 +126,404 @@ void CreateCylinderWithCut(double r1, double r2, double h,
     }
     else
     {
-        std::vector<Eigen::Vector3d> pnts;
-        std::vector<Eigen::Vector3d> vertices;
-        std::vector<Eigen::Vector3i> faces;
-        double theta = -2 * M_PI;
-        double ch = 0, cr = 0;
         int maxiter = 1000000;
-        int id = 0;
-        int last_id = -1;
         double epsilon_h = h / 100;
-        while ((last_id < 0 || id < last_id) && maxiter > 0)
-        {
-            maxiter--;
-            Eigen::Vector3d p1 = SampleOnSpiral(r1, r2, h, cut_angle, theta, ch, cr, equidistant);
-            if (theta >= 0 && ch < h)
-                pnts.push_back(p1);
-            vertices.push_back(p1);
-            p1(1) += epsilon_h;
-            if (ch == h && last_id == -1)
-                last_id = id + circle_res;
 
-            // cut
-            Eigen::Vector3d p3 = SampleOnSpiral(r1, r2, h, cut_angle, theta + 2 * M_PI, ch, cr, equidistant);
-            p3(1) -= epsilon_h;
-            vertices.push_back(p3);
+        // closed-form sizes: the spiral is sampled until circle_res steps past the first sample
+        // clamped to h; faces/edges stop at that sample and the last face / edge pair is dropped
+        WarnSpiralBudget(spiral, circle_res, maxiter, log);
+        int end_id = SpiralEndStep(spiral, circle_res, maxiter);
+        int nsteps = std::min(end_id + circle_res, maxiter);
+        int nface_steps = std::min(end_id, nsteps - 1);
+        int first_point = circle_res; // first step with theta >= 0
+        while (first_point > 0 && -2 * M_PI + (first_point - 1) * 2 * M_PI / circle_res >= 0)
+            first_point--;
+        while (-2 * M_PI + first_point * 2 * M_PI / circle_res < 0)
+            first_point++;
 
-            if (last_id < 0)
+        V = Eigen::MatrixXd(2 * nsteps, 3);
+        F = Eigen::MatrixXi(std::max(0, 2 * nface_steps - 1), 3);
+        P = Eigen::MatrixXd(std::max(0, std::min(end_id, nsteps) - first_point), 3);
+        size_t edges_begin = edges.size();
+        edges.resize(edges_begin + 4 * std::max(0, nface_steps - 1));
+
+        // every step only depends on its own theta, so the range is split across threads; each
+        // thread samples blocks of steps with one batched call
+        ParallelFor(nsteps, [&](int begin, int end)
+        {
+            // The theta + 2pi sample of step id is the theta sample of step id + circle_res, so the
+            // last turn of raw samples is kept in a ring (theta, x, y, z per slot) and reused when
+            // both thetas are bitwise equal; otherwise the step is resampled to keep V identical.
+            // Blocks are at most one turn long so a block never reads a slot it writes.
+            constexpr int max_block = 256;
+            const int block = std::min(max_block, circle_res);
+            std::vector<double> ring(4 * circle_res, NAN);
+            double th[2 * max_block], x[2 * max_block], y[2 * max_block], z[2 * max_block];
+            double ch[2 * max_block], cr[2 * max_block], p1s[3 * max_block];
+            int src[max_block];
+
+            for (int b = begin; b < end; b += block)
             {
-                edges.push_back(2 * id + 0);
-                edges.push_back(2 * (id + 1) + 0);
-                edges.push_back(2 * id + 1);
-                edges.push_back(2 * (id + 1) + 1);
+                int m = std::min(block, end - b);
+                int nsample = 0;
+                if (sampling == SpiralSampling::Recurrence)
+                {
+                    // theta and theta + 2pi runs of the block, each advanced by recurrence
+                    double theta = -2 * M_PI + b * 2 * M_PI / circle_res;
+                    double dtheta = 2 * M_PI / circle_res;
+                    for (int k = 0; k < m; k++)
+                        src[k] = k;
+                    nsample = m;
+                    SampleOnSpiralRecurrence(spiral, theta, dtheta, std::span<double>(x, m), std::span<double>(y, m),
+                                             std::span<double>(z, m), std::span<double>(ch, m),
+                                             std::span<double>(cr, m));
+                    SampleOnSpiralRecurrence(spiral, theta + 2 * M_PI, dtheta, std::span<double>(x + m, m),
+                                             std::span<double>(y + m, m), std::span<double>(z + m, m),
+                                             std::span<double>(ch + m, m), std::span<double>(cr + m, m));
+                    for (int k = 0; k < m; k++)
+                        th[m + k] = NAN; // nothing to reuse from the ring
+                }
+                else
+                {
+                    for (int k = 0; k < m; k++)
+                    {
+                        double theta = -2 * M_PI + (b + k) * 2 * M_PI / circle_res;
+                        const double* slot = &ring[4 * ((b + k) % circle_res)];
+                        if (std::bit_cast<uint64_t>(slot[0]) == std::bit_cast<uint64_t>(theta))
+                        {
+                            src[k] = -1;
+                            std::copy(slot + 1, slot + 4, p1s + 3 * k);
+                        }
+                        else
+                        {
+                            src[k] = nsample;
+                            th[nsample++] = theta;
+                        }
+                    }
+                    for (int k = 0; k < m; k++)
+                        th[nsample + k] = -2 * M_PI + (b + k) * 2 * M_PI / circle_res + 2 * M_PI;
+
+                    int n = nsample + m;
+                    SampleOnSpiralBatch(spiral, std::span<const double>(th, n), std::span<double>(x, n),
+                                        std::span<double>(y, n), std::span<double>(z, n), std::span<double>(ch, n),
+                                        std::span<double>(cr, n));
+                }
+
+                for (int k = 0; k < m; k++)
+                {
+                    int id = b + k;
+                    int k3 = nsample + k;
+                    double* slot = &ring[4 * (id % circle_res)];
+                    slot[0] = th[k3];
+                    slot[1] = x[k3];
+                    slot[2] = y[k3];
+                    slot[3] = z[k3];
 
-                // cut
-                faces.push_back(Eigen::Vector3i(2 * id + 0, 2 * (id + 1) + 0, 2 * id + 1));
-                faces.push_back(Eigen::Vector3i(2 * id + 1, 2 * (id + 1) + 0, 2 * (id + 1) + 1));
+                    Eigen::Vector3d p1 = src[k] < 0
+                                             ? Eigen::Vector3d(p1s[3 * k], p1s[3 * k + 1], p1s[3 * k + 2])
+                                             : Eigen::Vector3d(x[src[k]], y[src[k]], z[src[k]]);
+                    if (id >= first_point && id < end_id)
+                        P.row(id - first_point) = p1;
+                    V.row(2 * id + 0) = p1;
 
-                // no cut
-                //                faces.push_back(Eigen::Vector3i(id, id+1, id+circle_res));
-                //                faces.push_back(Eigen::Vector3i(id+circle_res, id+1, id+circle_res+1));
+                    // cut
+                    Eigen::Vector3d p3(x[k3], y[k3], z[k3]);
+                    p3(1) -= epsilon_h;
+                    V.row(2 * id + 1) = p3;
+
+                    if (id + 1 < nface_steps)
+                    {
+                        int* e = &edges[edges_begin + 4 * id];
+                        e[0] = 2 * id + 0;
+                        e[1] = 2 * (id + 1) + 0;
+                        e[2] = 2 * id + 1;
+                        e[3] = 2 * (id + 1) + 1;
+                    }
+                    if (id < nface_steps)
+                    {
+                        // cut
+                        F.row(2 * id + 0) = Eigen::Vector3i(2 * id + 0, 2 * (id + 1) + 0, 2 * id + 1);
+                        if (2 * id + 1 < F.rows())
+                            F.row(2 * id + 1) = Eigen::Vector3i(2 * id + 1, 2 * (id + 1) + 0, 2 * (id + 1) + 1);
+
+                        // no cut
+                        //                faces.push_back(Eigen::Vector3i(id, id+1, id+circle_res));
+                        //                faces.push_back(Eigen::Vector3i(id+circle_res, id+1, id+circle_res+1));
+                    }
+                }
             }
+        });
+    }
+}
+
+void CreateCylinderWithCutAdaptive(const SpiralParams& spiral, double max_chord_error,
+                                   Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>& V,
+                                   Eigen::Matrix<int, Eigen::Dynamic, Eigen::Dynamic>& F,
+                                   Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>& P,
+                                   std::vector<int>& edges, std::vector<double>& step_theta, std::ostream& log)
+{
+    const int maxiter = 1000000;
+    const double max_step = M_PI / 8; // keeps the narrow end from degenerating into long slivers
+    const double epsilon_h = spiral.h / 100;
+    const double theta_end = SpiralEndTheta(spiral);
+    if (std::isinf(theta_end))
+    {
+        log << "[WARNING] Spiral never reaches h = " << spiral.h << " for r1 = " << spiral.r1 << ", r2 = "
+            << spiral.r2 << ", cut_angle = " << spiral.cut_angle << "; the mesh is truncated at " << maxiter
+            << " samples" << std::endl;
+    }
 
-            id++;
-            theta = -2 * M_PI + id * 2 * M_PI / circle_res;
+    // The steps depend on each other, so they are chosen serially: the chord of a circle of
+    // radius r with sagitta tol spans 2*acos(1 - tol/r), taken for the wider of the two chains,
+    // then both chains are checked at the quarter points (the height also bends the spiral) and
+    // the step is shortened until they are within tolerance.
+    // The samples are kept, so V is filled without sampling again.
+    std::vector<Eigen::Vector3d> samples; // theta and theta + 2pi sample per step
+    step_theta.clear();
+    double theta = -2 * M_PI;
+    double ch, cr, ch2, cr2;
+    Eigen::Vector3d p0 = SampleOnSpiral(spiral, theta, ch, cr);
+    Eigen::Vector3d q0 = SampleOnSpiral(spiral, theta + 2 * M_PI, ch2, cr2);
+    bool reached = false;
+    while ((int)step_theta.size() < maxiter)
+    {
+        step_theta.push_back(theta);
+        samples.push_back(p0);
+        samples.push_back(q0);
+        if (ch == spiral.h)
+        {
+            reached = true;
+            break;
+        }
+
+        double r = std::max(cr, cr2);
+        double dtheta = max_chord_error < r ? std::min(max_step, 2 * acos(1 - max_chord_error / r)) : max_step;
+        // land on the angles where a chain has a kink: the height clamps to 0 at theta = 0 and
+        // to h at theta_end (theta_end - 2pi for the theta + 2pi chain)
+        for (double kink : {0.0, theta_end - 2 * M_PI, theta_end})
+            if (theta < kink && theta + dtheta > kink)
+                dtheta = kink - theta;
+
+        Eigen::Vector3d p1, q1;
+        double ch1, cr1, cr21;
+        for (int shrink = 0; ; shrink++)
+        {
+            double chm, crm;
+            p1 = SampleOnSpiral(spiral, theta + dtheta, ch1, cr1);
+            q1 = SampleOnSpiral(spiral, theta + dtheta + 2 * M_PI, chm, cr21);
+            double deviation = 0;
+            for (double t : {0.25, 0.5, 0.75})
+            {
+                Eigen::Vector3d pm = SampleOnSpiral(spiral, theta + t * dtheta, chm, crm);
+                Eigen::Vector3d qm = SampleOnSpiral(spiral, theta + t * dtheta + 2 * M_PI, chm, crm);
+                deviation = std::max(deviation, (pm - p0 - t * (p1 - p0)).norm());
+                deviation = std::max(deviation, (qm - q0 - t * (q1 - q0)).norm());
+            }
+            if (deviation <= max_chord_error)
+                break;
+            if (shrink == 16)
+            {
+                log << "[WARNING] Adaptive step at theta = " << theta << " accepted after " << shrink
+                    << " shrinks with chord deviation " << deviation << ", over max_chord_error = "
+                    << max_chord_error << std::endl;
+                break;
+            }
+            dtheta *= 0.75;
         }
-        P = Eigen::MatrixXd(pnts.size(), 3);
-        for (int i = 0; i < pnts.size(); i++)
-            P.row(i) = pnts[i];
-        V = Eigen::MatrixXd(vertices.size(), 3);
-        for (int i = 0; i < vertices.size(); i++)
-            V.row(i) = vertices[i];
 
-        F = Eigen::MatrixXi::Zero(faces.size() - 1, 3);
-        for (int i = 0; i < faces.size() - 1; i++)
+        theta += dtheta;
+        p0 = p1;
+        q0 = q1;
+        ch = ch1;
+        cr = cr1;
+        cr2 = cr21;
+    }
+
+    const int nsteps = (int)step_theta.size();
+    const int end_id = reached ? nsteps - 1 : nsteps;
+    const int nface_steps = std::min(end_id, nsteps - 1);
+    int first_point = 0; // first step with theta >= 0
+    while (first_point < nsteps && step_theta[first_point] < 0)
+        first_point++;
+
+    V = Eigen::MatrixXd(2 * nsteps, 3);
+    F = Eigen::MatrixXi(std::max(0, 2 * nface_steps - 1), 3);
+    P = Eigen::MatrixXd(std::max(0, end_id - first_point), 3);
+    size_t edges_begin = edges.size();
+    edges.resize(edges_begin + 4 * std::max(0, nface_steps - 1));
+
+    for (int id = 0; id < nsteps; id++)
+    {
+        if (id >= first_point && id < end_id)
+            P.row(id - first_point) = samples[2 * id];
+        V.row(2 * id + 0) = samples[2 * id];
+
+        // cut
+        Eigen::Vector3d p3 = samples[2 * id + 1];
+        p3(1) -= epsilon_h;
+        V.row(2 * id + 1) = p3;
+
+        if (id + 1 < nface_steps)
         {
-            assert(faces[i](0)>=0 && faces[i](0)<V.rows()
-                && faces[i](1)>=0 && faces[i](1)<V.rows()
-                && faces[i](2)>=0 && faces[i](2)<V.rows());
-            F.row(i) = faces[i];
+            int* e = &edges[edges_begin + 4 * id];
+            e[0] = 2 * id + 0;
+            e[1] = 2 * (id + 1) + 0;
+            e[2] = 2 * id + 1;
+            e[3] = 2 * (id + 1) + 1;
+        }
+        if (id < nface_steps)
+        {
+            F.row(2 * id + 0) = Eigen::Vector3i(2 * id + 0, 2 * (id + 1) + 0, 2 * id + 1);
+            if (2 * id + 1 < F.rows())
+                F.row(2 * id + 1) = Eigen::Vector3i(2 * id + 1, 2 * (id + 1) + 0, 2 * (id + 1) + 1);
         }
-        edges.erase(edges.begin() + edges.size() - 4, edges.end());
     }
 }
 
-Eigen::Vector3d Cross(const Eigen::Vector3d& v1, const Eigen::Vector3d& v2)
+template <typename Scalar>
+Eigen::Matrix<Scalar, 3, 1> Cross(const Eigen::Matrix<Scalar, 3, 1>& v1, const Eigen::Matrix<Scalar, 3, 1>& v2)
 {
-    return Eigen::Vector3d(v1.y() * v2.z() - v1.z() * v2.y(),
-                           v1.x() * v2.z() - v1.z() * v2.x(),
-                           v1.x() * v2.y() - v1.y() * v2.x());
+    return Eigen::Matrix<Scalar, 3, 1>(v1.y() * v2.z() - v1.z() * v2.y(),
+                                       v1.z() * v2.x() - v1.x() * v2.z(),
+                                       v1.x() * v2.y() - v1.y() * v2.x());
 }
 
-void UnwarpCylinder(Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>& V,
-                    Eigen::Matrix<int, Eigen::Dynamic, Eigen::Dynamic>& F,
-                    Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>& Vuv)
+void BuildEdgeFaceAdjacency(const Eigen::Matrix<int, Eigen::Dynamic, Eigen::Dynamic>& F, int nvertices,
+                            EdgeFaceAdjacency& adj)
 {
-    Vuv = Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>::Zero(V.rows(), 3);
+    // counting sort of the 3 edges of every face into the bucket of their smaller vertex
+    adj.offsets.assign(nvertices + 1, 0);
+    for (int f = 0; f < F.rows(); f++)
+        for (int c = 0; c < 3; c++)
+            adj.offsets[std::min(F(f, (c + 1) % 3), F(f, (c + 2) % 3)) + 1]++;
+    for (int i = 0; i < nvertices; i++)
+        adj.offsets[i + 1] += adj.offsets[i];
+
+    int nentries = adj.offsets[nvertices];
+    adj.other.resize(nentries);
+    adj.faces.resize(nentries);
+    adj.corners.resize(nentries);
+    std::vector<int> fill(adj.offsets.begin(), adj.offsets.end() - 1);
+    for (int f = 0; f < F.rows(); f++)
+    {
+        for (int c = 0; c < 3; c++)
+        {
+            int va = F(f, (c + 1) % 3);
+            int vb = F(f, (c + 2) % 3);
+            int slot = fill[std::min(va, vb)]++;
+            adj.other[slot] = std::max(va, vb);
+            adj.faces[slot] = f;
+            adj.corners[slot] = c;
+        }
+    }
+}
+
+int FindAdjacentFace(const EdgeFaceAdjacency& adj, int va, int vb, int before, int& corner)
+{
+    int vmin = std::min(va, vb);
+    int vmax = std::max(va, vb);
+    // faces were inserted in increasing order, so the first hit has the lowest index
+    for (int i = adj.offsets[vmin]; i < adj.offsets[vmin + 1]; i++)
+    {
+        if (adj.faces[i] >= before)
+            break;
+        if (adj.other[i] == vmax)
+        {
+            corner = adj.corners[i];
+            return adj.faces[i];
+        }
+    }
+    corner = -1;
+    return -1;
+}
+
+// Layout of the first face of an unfolding: p0 at the origin, p1 on +x, p2 on the +y side. p2
+// keeps both of its edge lengths for any angle at p0 (the coordinates along and across p0p1).
+template <typename Scalar>
+static void FirstFaceLayout(const Eigen::Matrix<Scalar, 3, 1>& p0, const Eigen::Matrix<Scalar, 3, 1>& p1,
+                            const Eigen::Matrix<Scalar, 3, 1>& p2, Eigen::Matrix<Scalar, 2, 1> q[3])
+{
+    Scalar l1 = (p1 - p0).norm();
+    Scalar along = (p2 - p0).dot(p1 - p0) / l1;
+
+    q[0] = Eigen::Matrix<Scalar, 2, 1>(0, 0);
+    q[1] = Eigen::Matrix<Scalar, 2, 1>(l1, 0);
+    q[2] = Eigen::Matrix<Scalar, 2, 1>(along, sqrt(std::max(Scalar(0), (p2 - p0).squaredNorm() - along * along)));
+}
+
+// Unfolded position of p1, the new vertex of a face whose edge (p2, p3) is already flattened at
+// (p2_2d, p3_2d). `opposite` is the flattened third vertex of the face across that edge, if any;
+// p1 goes to the other side of the edge.
+template <typename Scalar>
+static Eigen::Matrix<Scalar, 2, 1> PlaceVertex(const Eigen::Matrix<Scalar, 3, 1>& p1, const Eigen::Matrix<Scalar, 3, 1>& p2,
+                                               const Eigen::Matrix<Scalar, 3, 1>& p3, const Eigen::Matrix<Scalar, 2, 1>& p2_2d,
+                                               const Eigen::Matrix<Scalar, 2, 1>& p3_2d,
+                                               const Eigen::Matrix<Scalar, 2, 1>* opposite, UnwrapPlacement placement)
+{
+    typedef Eigen::Matrix<Scalar, 3, 1> Vector3;
+    typedef Eigen::Matrix<Scalar, 2, 1> Vector2;
+
+    Vector2 vref = (p3_2d - p2_2d).normalized();
+    Vector2 vref_norm(vref.y(), -vref.x());
+    if (placement == UnwrapPlacement::Projection)
+    {
+        // coordinates of p1 along and across the reference edge, straight from the 3D vectors
+        Vector3 e = p3 - p2, d = p1 - p2;
+        Scalar e_len = e.norm();
+        Scalar along = d.dot(e) / e_len;
+        Scalar across = Cross(e, d).norm() / e_len;
+        // new vertex on the side opposite to the face across the edge (the rotation below
+        // puts it on the -vref_norm side)
+        if (opposite && (across <= 0) == ((*opposite - p2_2d).dot(vref_norm) >= 0))
+            across = -across;
+        return along * vref - across * vref_norm + p2_2d;
+    }
+
+    Scalar alpha = acos((p3 - p2).normalized().dot((p1 - p2).normalized()));
+    Scalar p12_len = (p1 - p2).norm();
+    //double beta = acos((p2-p3).normalized().dot((p1-p3).normalized()));
+    Vector2 dir(cos(alpha) * vref(0) - sin(alpha) * vref(1),
+                sin(alpha) * vref(0) + cos(alpha) * vref(1));
+    bool flip = false;
+    if (opposite)
+    {
+        if ((dir.dot(vref_norm) >= 0) == ((*opposite - p2_2d).dot(vref_norm) >= 0))
+            flip = true;
+    }
+    if (flip)
+    {
+        alpha *= -1;
+        dir = Vector2(cos(alpha) * vref(0) - sin(alpha) * vref(1),
+                      sin(alpha) * vref(0) + cos(alpha) * vref(1));
+    }
+    return dir * p12_len + p2_2d;
+}
+
+template <typename Scalar, typename DerivedV, typename DerivedF>
+void UnwarpCylinder(const Eigen::MatrixBase<DerivedV>& V, const Eigen::MatrixBase<DerivedF>& F, UVBuffer<Scalar>& Vuv,
+                    UnwrapPlacement placement)
+{
+    typedef Eigen::Matrix<Scalar, 3, 1> Vector3;
+    typedef Eigen::Matrix<Scalar, 2, 1> Vector2;
+    auto vertex = [&](int i) -> Vector3 { return V.row(i).transpose().template cast<Scalar>(); };
+
+    Vuv = UVBuffer<Scalar>::Zero(V.rows(), 2);
+    // no faces (a strip shorter than one step): nothing to lay out
+    if (F.rows() == 0)
+        return;
     bool* flattened = new bool[V.rows()];
     for (int i = 0; i < V.rows(); i++)
         flattened[i] = false;
 
-    // estimate plane from the first face
-    //Eigen::Vector3d plane_point = V.row(F(0,0));
-    Eigen::Vector3d plane_u = (V.row(F(0, 1)) - V.row(F(0, 0))).normalized();
-    Eigen::Vector3d vec2 = (V.row(F(0, 2)) - V.row(F(0, 0))).normalized();
-    Eigen::Vector3d plane_norm = Cross(plane_u, vec2);
-    Eigen::Vector3d plane_v = Cross(plane_u, plane_norm);
-
-    double l1 = (V.row(F(0, 1)) - V.row(F(0, 0))).norm();
-    double l2 = (V.row(F(0, 2)) - V.row(F(0, 0))).norm();
+    // built on the first face that is not in strip order (never for CreateCylinderWithCut meshes)
+    EdgeFaceAdjacency adj;
+    bool have_adj = false;
+    int prev_new = -1; // vertex flattened by face f-1 (-1 for face 0, which flattens all three)
 
-    Vuv.row(F(0, 0)) = Eigen::Vector3d(0, 0, 0);
-    Vuv.row(F(0, 1)) = Eigen::Vector3d(l1, 0, 0);
-    Vuv.row(F(0, 2)) = Eigen::Vector3d(l2 * vec2.dot(plane_u), l2 * vec2.dot(plane_v), 0);
+    Vector2 q[3];
+    FirstFaceLayout<Scalar>(vertex(F(0, 0)), vertex(F(0, 1)), vertex(F(0, 2)), q);
+    for (int c = 0; c < 3; c++)
+        Vuv.row(F(0, c)) = q[c];
 
     flattened[F(0, 0)] = true;
     flattened[F(0, 1)] = true;
@@ -173,70 +552,576 @@ void UnwarpCylinder(Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>& V,
             v3 = 1;
         }
 
-        // todo: this can be done faster
+        // Strip order: if face f-1 contains the edge and the edge contains the vertex f-1 flattened,
+        // no earlier face can contain the edge, so f-1 is the lowest adjacent face and the lookup
+        // is skipped. Otherwise search the edge -> face adjacency.
         int f2_v1 = -1;
-        int f2;
-        for (f2 = 0; f2 < F.rows(); f2++)
+        int f2 = -1;
+        int a = F(f, v2), b = F(f, v3);
+        if (prev_new == -1 || prev_new == a || prev_new == b)
         {
-            if ((F(f, v2) == F(f2, 0) || F(f, v2) == F(f2, 1))
-                && (F(f, v3) == F(f2, 0) || F(f, v3) == F(f2, 1)))
+            for (int c = 0; c < 3 && f2 == -1; c++)
             {
-                f2_v1 = 2;
-                break;
-            }
-            else if ((F(f, v2) == F(f2, 0) || F(f, v2) == F(f2, 2))
-                && (F(f, v3) == F(f2, 0) || F(f, v3) == F(f2, 2)))
-            {
-                f2_v1 = 1;
-                break;
+                int c1 = (c + 1) % 3, c2 = (c + 2) % 3;
+                if ((F(f - 1, c1) == a && F(f - 1, c2) == b) || (F(f - 1, c1) == b && F(f - 1, c2) == a))
+                {
+                    f2 = f - 1;
+                    f2_v1 = c;
+                }
             }
-            else if ((F(f, v2) == F(f2, 2) || F(f, v2) == F(f2, 1))
-                && (F(f, v3) == F(f2, 2) || F(f, v3) == F(f2, 1)))
+        }
+        if (f2 == -1)
+        {
+            if (!have_adj)
             {
-                f2_v1 = 0;
-                break;
+                BuildEdgeFaceAdjacency(F, V.rows(), adj);
+                have_adj = true;
             }
+            f2 = FindAdjacentFace(adj, a, b, f, f2_v1);
         }
+        prev_new = F(f, v1);
 
         // flatten the remaining point
-        Eigen::Vector3d p1 = V.row(F(f, v1));
-        Eigen::Vector3d p2 = V.row(F(f, v2));
-        Eigen::Vector3d p3 = V.row(F(f, v3));
-
-        Eigen::Vector3d p2_2d = Vuv.row(F(f, v2));
-        Eigen::Vector3d p3_2d = Vuv.row(F(f, v3));
-
-        double alpha = acos((p3 - p2).normalized().dot((p1 - p2).normalized()));
-        double p12_len = (p1 - p2).norm();
-        //double beta = acos((p2-p3).normalized().dot((p1-p3).normalized()));
-        Eigen::Vector3d vref = (p3_2d - p2_2d).normalized();
-        Eigen::Vector3d vref_norm(vref.y(), -vref.x(), 0);
-        Eigen::Vector3d p1_2d = Eigen::Vector3d(cos(alpha) * vref(0) - sin(alpha) * vref(1),
-                                                sin(alpha) * vref(0) + cos(alpha) * vref(1), 0);
-        bool flip = false;
+        Vector2 opposite;
         if (f2_v1 != -1)
+            opposite = Vuv.row(F(f2, f2_v1));
+        Vector2 p1_2d = PlaceVertex<Scalar>(vertex(F(f, v1)), vertex(F(f, v2)), vertex(F(f, v3)), Vuv.row(F(f, v2)),
+                                            Vuv.row(F(f, v3)), f2_v1 != -1 ? &opposite : nullptr, placement);
+
+        flattened[F(f, v1)] = true;
+        Vuv.row(F(f, v1)) = p1_2d;
+    }
+
+    delete [] flattened;
+}
+
+template void UnwarpCylinder<double>(const Eigen::MatrixBase<Eigen::MatrixXd>&,
+                                      const Eigen::MatrixBase<Eigen::MatrixXi>&, UVBuffer<double>&, UnwrapPlacement);
+template void UnwarpCylinder<float>(const Eigen::MatrixBase<Eigen::MatrixXd>&,
+                                     const Eigen::MatrixBase<Eigen::MatrixXi>&, UVBuffer<float>&, UnwrapPlacement);
+template void UnwarpCylinder<double>(const Eigen::MatrixBase<MeshVertices<double>>&,
+                                      const Eigen::MatrixBase<MeshFaces>&, UVBuffer<double>&, UnwrapPlacement);
+template void UnwarpCylinder<float>(const Eigen::MatrixBase<MeshVertices<float>>&,
+                                     const Eigen::MatrixBase<MeshFaces>&, UVBuffer<float>&, UnwrapPlacement);
+
+void UnwarpCylinder(Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>& V,
+                    Eigen::Matrix<int, Eigen::Dynamic, Eigen::Dynamic>& F,
+                    Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>& Vuv,
+                    UnwrapPlacement placement)
+{
+    UVBuffer<double> uv;
+    UnwarpCylinder<double>(V, F, uv, placement);
+    Vuv = Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>::Zero(V.rows(), 3);
+    Vuv.leftCols<2>() = uv;
+}
+
+// Shared sizes of the streamed strip, as in CreateCylinderWithCut; nface_steps < 1 means no faces
+struct StripLayout
+{
+    double epsilon_h;
+    int nface_steps;
+    int nfaces;
+};
+
+static StripLayout StreamStripLayout(const SpiralParams& spiral, int circle_res, std::ostream& log)
+{
+    const int maxiter = 1000000;
+    WarnSpiralBudget(spiral, circle_res, maxiter, log);
+    int end_id = SpiralEndStep(spiral, circle_res, maxiter);
+    int nsteps = std::min(end_id + circle_res, maxiter);
+    int nface_steps = std::min(end_id, nsteps - 1);
+    return StripLayout{spiral.h / 100, nface_steps, 2 * nface_steps - 1};
+}
+
+// Spiral samples of steps a .. b (the faces of step b-1 reach into step b): entries [0, m) are
+// theta and [m, 2m) are theta + 2 pi, with m = b + 1 - a
+struct StripSamples
+{
+    int a = 0, b = 0;
+    std::vector<double> th, x, y, z, ch, cr;
+};
+
+static void SampleStripSteps(const SpiralParams& spiral, int circle_res, int a, int b, StripSamples& s)
+{
+    int m = b + 1 - a;
+    s.a = a;
+    s.b = b;
+    for (auto* v : {&s.th, &s.x, &s.y, &s.z, &s.ch, &s.cr})
+        if ((int)v->size() < 2 * m)
+            v->resize(2 * m);
+    for (int k = 0; k < m; k++)
+    {
+        s.th[k] = -2 * M_PI + (a + k) * 2 * M_PI / circle_res;
+        s.th[m + k] = -2 * M_PI + (a + k) * 2 * M_PI / circle_res + 2 * M_PI;
+    }
+    SampleOnSpiralBatch(spiral, std::span<const double>(s.th.data(), 2 * m), std::span<double>(s.x.data(), 2 * m),
+                        std::span<double>(s.y.data(), 2 * m), std::span<double>(s.z.data(), 2 * m),
+                        std::span<double>(s.ch.data(), 2 * m), std::span<double>(s.cr.data(), 2 * m));
+}
+
+// Unfolding state carried from one chunk of steps to the next. Step id unfolds faces 2*id and
+// 2*id+1 (UnwarpCylinder's strip order), which add vertices 2*id+2 and 2*id+3 against vertices
+// 2*id-1 .. 2*id+1, so both rings hold vertices by index % 4.
+struct StripUnfolder
+{
+    StripLayout layout;
+    UnwrapPlacement placement;
+    Eigen::Vector3d p[4] = {};
+    Eigen::Vector2d q[4] = {};
+    int placed = 0; // vertices [0, placed) are unfolded
+
+    // unfolds the steps of s; returns the index of the first vertex appended to uv
+    int Unfold(const StripSamples& s, std::vector<double>& uv, std::vector<double>& segments)
+    {
+        const int m = s.b + 1 - s.a;
+        const double epsilon_h = layout.epsilon_h;
+        uv.clear();
+        segments.clear();
+        const int first_vertex = placed;
+        auto emit = [&](int i)
         {
-            Eigen::Vector3d pexst = Vuv.row(F(f2, f2_v1));
-            if ((p1_2d.dot(vref_norm) >= 0) == ((pexst - p2_2d).dot(vref_norm)) >= 0)
-                flip = true;
-            //std::cout<<"F("<<f<<"): existing: "<<(pexst-p2_2d).dot(vref_norm)<<std::endl;
+            uv.push_back(q[i % 4].x());
+            uv.push_back(q[i % 4].y());
+            placed = i + 1;
+        };
+        for (int id = s.a; id < s.b; id++)
+        {
+            int k = id - s.a;
+            p[(2 * id) % 4] = Eigen::Vector3d(s.x[k], s.y[k], s.z[k]);
+            p[(2 * id + 1) % 4] = Eigen::Vector3d(s.x[m + k], s.y[m + k] - epsilon_h, s.z[m + k]);
+            p[(2 * id + 2) % 4] = Eigen::Vector3d(s.x[k + 1], s.y[k + 1], s.z[k + 1]);
+            p[(2 * id + 3) % 4] = Eigen::Vector3d(s.x[m + k + 1], s.y[m + k + 1] - epsilon_h, s.z[m + k + 1]);
+            auto P = [&](int i) -> const Eigen::Vector3d& { return p[i % 4]; };
+            auto Q = [&](int i) -> Eigen::Vector2d& { return q[i % 4]; };
+
+            if (id == 0)
+            {
+                // face 0 is (0, 2, 1)
+                Eigen::Vector2d first[3];
+                FirstFaceLayout<double>(P(0), P(2), P(1), first);
+                Q(0) = first[0];
+                Q(2) = first[1];
+                Q(1) = first[2];
+                emit(0);
+                emit(1);
+            }
+            else
+            {
+                // face 2*id = (2*id, 2*id+2, 2*id+1), across the edge from vertex 2*id-1
+                Q(2 * id + 2) = PlaceVertex<double>(P(2 * id + 2), P(2 * id), P(2 * id + 1), Q(2 * id),
+                                                    Q(2 * id + 1), &Q(2 * id - 1), placement);
+            }
+            emit(2 * id + 2);
+
+            if (2 * id + 1 < layout.nfaces)
+            {
+                // face 2*id+1 = (2*id+1, 2*id+2, 2*id+3), across the edge from vertex 2*id
+                Q(2 * id + 3) = PlaceVertex<double>(P(2 * id + 3), P(2 * id + 1), P(2 * id + 2), Q(2 * id + 1),
+                                                    Q(2 * id + 2), &Q(2 * id), placement);
+                emit(2 * id + 3);
+            }
+
+            if (id + 1 < layout.nface_steps)
+            {
+                for (int i : {2 * id, 2 * id + 1})
+                {
+                    segments.push_back(Q(i).x());
+                    segments.push_back(Q(i).y());
+                    segments.push_back(Q(i + 2).x());
+                    segments.push_back(Q(i + 2).y());
+                }
+            }
         }
-        //std::cout<<"F("<<f<<"): new: "<<<<std::endl;
-        if (flip)
+        return first_vertex;
+    }
+};
+
+void StreamCylinderWithCut(const SpiralParams& spiral, int circle_res, int chunk_steps,
+                           const std::function<void(const StripChunk&)>& sink, UnwrapPlacement placement,
+                           std::ostream& log)
+{
+    // same sizes as CreateCylinderWithCut; only the vertices of its faces are produced
+    StripLayout layout = StreamStripLayout(spiral, circle_res, log);
+    if (layout.nface_steps < 1)
+        return;
+
+    chunk_steps = std::max(1, chunk_steps);
+    StripSamples samples;
+    std::vector<double> uv, segments;
+    uv.reserve(2 * (2 * chunk_steps + 2));
+    segments.reserve(8 * chunk_steps);
+
+    StripUnfolder unfolder{layout, placement};
+    for (int a = 0; a < layout.nface_steps; a += chunk_steps)
+    {
+        SampleStripSteps(spiral, circle_res, a, std::min(layout.nface_steps, a + chunk_steps), samples);
+        int first_vertex = unfolder.Unfold(samples, uv, segments);
+        sink(StripChunk{first_vertex, uv, segments});
+    }
+}
+
+// Output chunk as it travels between the unfold and sink stages
+struct StripChunkBuffer
+{
+    int first_vertex = 0;
+    int steps = 0;
+    std::vector<double> uv, segments;
+};
+
+static double ElapsedMs(std::chrono::steady_clock::time_point since)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - since).count();
+}
+
+void StreamCylinderWithCutPipelined(const SpiralParams& spiral, int circle_res, int chunk_steps,
+                                    const std::function<void(const StripChunk&)>& sink,
+                                    std::array<PipelineStageStats, 3>& stats, int queue_chunks,
+                                    UnwrapPlacement placement, std::ostream& log)
+{
+    typedef std::chrono::steady_clock Clock;
+    stats = {PipelineStageStats{"sample"}, PipelineStageStats{"unfold"}, PipelineStageStats{"sink"}};
+    StripLayout layout = StreamStripLayout(spiral, circle_res, log);
+    if (layout.nface_steps < 1)
+        return;
+    chunk_steps = std::max(1, chunk_steps);
+    queue_chunks = std::max(1, queue_chunks);
+
+    SpscQueue<StripSamples> sampled(queue_chunks);
+    SpscQueue<StripChunkBuffer> unfolded(queue_chunks);
+    // a failing stage cancels both queues so the others stop instead of waiting on it forever;
+    // its exception is rethrown on the calling thread once both workers are joined
+    std::exception_ptr sample_error, unfold_error;
+    auto cancel = [&]
+    {
+        sampled.Cancel();
+        unfolded.Cancel();
+    };
+
+    std::thread sampler([&]
+    {
+        PipelineStageStats& st = stats[0];
+        try
         {
-            alpha *= -1;
-            p1_2d = Eigen::Vector3d(cos(alpha) * vref(0) - sin(alpha) * vref(1),
-                                    sin(alpha) * vref(0) + cos(alpha) * vref(1), 0);
+            for (int a = 0; a < layout.nface_steps; a += chunk_steps)
+            {
+                auto t0 = Clock::now();
+                StripSamples* s = sampled.WriteSlot();
+                if (!s)
+                    return;
+                auto t1 = Clock::now();
+                int b = std::min(layout.nface_steps, a + chunk_steps);
+                SampleStripSteps(spiral, circle_res, a, b, *s);
+                sampled.Push();
+                st.wait_ms += std::chrono::duration<double, std::milli>(t1 - t0).count();
+                st.busy_ms += ElapsedMs(t1);
+                st.chunks++;
+                st.steps += b - a;
+            }
+            sampled.Close();
         }
+        catch (...)
+        {
+            sample_error = std::current_exception();
+            cancel();
+        }
+    });
 
-        flattened[F(f, v1)] = true;
-        Vuv.row(F(f, v1)) = p1_2d * p12_len + p2_2d;
+    std::thread unfolder_thread([&]
+    {
+        PipelineStageStats& st = stats[1];
+        try
+        {
+            StripUnfolder unfolder{layout, placement};
+            while (true)
+            {
+                auto t0 = Clock::now();
+                StripSamples* s = sampled.ReadSlot();
+                if (!s)
+                    break;
+                StripChunkBuffer* out = unfolded.WriteSlot();
+                if (!out)
+                    return;
+                auto t1 = Clock::now();
+                out->first_vertex = unfolder.Unfold(*s, out->uv, out->segments);
+                out->steps = s->b - s->a;
+                sampled.Pop();
+                unfolded.Push();
+                st.wait_ms += std::chrono::duration<double, std::milli>(t1 - t0).count();
+                st.busy_ms += ElapsedMs(t1);
+                st.chunks++;
+                st.steps += out->steps;
+            }
+            unfolded.Close();
+        }
+        catch (...)
+        {
+            unfold_error = std::current_exception();
+            cancel();
+        }
+    });
+
+    // the sink runs on the calling thread, so it may write to streams the caller owns; if it
+    // throws, the workers are cancelled and joined before the exception leaves
+    PipelineStageStats& st = stats[2];
+    try
+    {
+        while (true)
+        {
+            auto t0 = Clock::now();
+            StripChunkBuffer* c = unfolded.ReadSlot();
+            if (!c)
+                break;
+            auto t1 = Clock::now();
+            sink(StripChunk{c->first_vertex, c->uv, c->segments});
+            st.wait_ms += std::chrono::duration<double, std::milli>(t1 - t0).count();
+            st.busy_ms += ElapsedMs(t1);
+            st.chunks++;
+            st.steps += c->steps;
+            unfolded.Pop();
+        }
+    }
+    catch (...)
+    {
+        cancel();
+        sampler.join();
+        unfolder_thread.join();
+        throw;
     }
 
-    delete [] flattened;
+    sampler.join();
+    unfolder_thread.join();
+    if (sample_error)
+        std::rethrow_exception(sample_error);
+    if (unfold_error)
+        std::rethrow_exception(unfold_error);
 }
 
+// Rigid 2D map p -> m * p + t (m orthogonal, possibly a reflection)
+struct Rigid2
+{
+    Eigen::Matrix2d m = Eigen::Matrix2d::Identity();
+    Eigen::Vector2d t = Eigen::Vector2d::Zero();
+};
+
+// a after b
+static Rigid2 Compose(const Rigid2& a, const Rigid2& b)
+{
+    Rigid2 c;
+    c.m = a.m * b.m;
+    c.t = a.m * b.t + a.t;
+    return c;
+}
+
+// Face g laid out in its own plane: F(g,0) at the origin, F(g,1) on +x. Face 0 goes through
+// UnwarpCylinder's own first-face code so both start from the same layout.
+static void FaceLocal(const Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>& V,
+                      const Eigen::Matrix<int, Eigen::Dynamic, Eigen::Dynamic>& F, int g, Eigen::Vector2d q[3])
+{
+    Eigen::Vector3d e1 = V.row(F(g, 1)) - V.row(F(g, 0));
+    Eigen::Vector3d e2 = V.row(F(g, 2)) - V.row(F(g, 0));
+    double l1 = e1.norm();
+    q[0] = Eigen::Vector2d(0, 0);
+    q[1] = Eigen::Vector2d(l1, 0);
+    if (g == 0)
+        FirstFaceLayout<double>(V.row(F(g, 0)), V.row(F(g, 1)), V.row(F(g, 2)), q);
+    else
+    {
+        double x = e2.dot(e1) / l1;
+        q[2] = Eigen::Vector2d(x, sqrt(std::max(0.0, e2.squaredNorm() - x * x)));
+    }
+}
+
+void UnwarpCylinderParallel(Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>& V,
+                            Eigen::Matrix<int, Eigen::Dynamic, Eigen::Dynamic>& F,
+                            Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>& Vuv)
+{
+    const int nfaces = F.rows();
+    if (nfaces == 0)
+    {
+        Vuv = Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>::Zero(V.rows(), 3);
+        return;
+    }
+
+    // phase 1, per face: its layout in its own plane and the rigid map into the layout of face f-1
+    // that puts the shared edge on top of it and the new vertex on the far side of the edge
+    std::vector<Rigid2> rel(nfaces);
+    std::vector<int> fresh(nfaces); // local index of the vertex face f adds
+    std::vector<Eigen::Vector2d> fresh_local(nfaces);
+    std::vector<std::atomic<int>> owner(V.rows());
+    for (int c = 0; c < 3; c++)
+        owner[F(0, c)].store(0, std::memory_order_relaxed);
+    std::atomic<bool> strip(true);
+
+    ParallelFor(nfaces - 1, [&](int begin, int end)
+    {
+        for (int f = begin + 1; f < end + 1; f++)
+        {
+            int v1 = -1, nshared = 0;
+            for (int c = 0; c < 3; c++)
+            {
+                if (F(f, c) == F(f - 1, 0) || F(f, c) == F(f - 1, 1) || F(f, c) == F(f - 1, 2))
+                    nshared++;
+                else
+                    v1 = c;
+            }
+            if (nshared != 2)
+            {
+                strip.store(false, std::memory_order_relaxed);
+                continue;
+            }
+            int v2 = v1 == 0 ? 1 : 0;
+            int v3 = v1 == 2 ? 1 : 2;
+            owner[F(f, v1)].store(f, std::memory_order_relaxed);
+
+            Eigen::Vector2d q[3], qp[3];
+            FaceLocal(V, F, f, q);
+            FaceLocal(V, F, f - 1, qp);
+            int c2 = 0, c3 = 0, co = 0; // corners of f-1: the shared edge and the opposite vertex
+            for (int c = 0; c < 3; c++)
+            {
+                if (F(f - 1, c) == F(f, v2))
+                    c2 = c;
+                else if (F(f - 1, c) == F(f, v3))
+                    c3 = c;
+                else
+                    co = c;
+            }
+
+            // rotation taking the edge direction of f onto the one of f-1
+            Eigen::Vector2d a = (q[v3] - q[v2]).normalized();
+            Eigen::Vector2d b = (qp[c3] - qp[c2]).normalized();
+            Rigid2& r = rel[f];
+            r.m << a.dot(b), -(a.x() * b.y() - a.y() * b.x()),
+                a.x() * b.y() - a.y() * b.x(), a.dot(b);
+            Eigen::Vector2d side(b.y(), -b.x());
+            if (((r.m * (q[v1] - q[v2])).dot(side) >= 0) == ((qp[co] - qp[c2]).dot(side) >= 0))
+                r.m = (2 * b * b.transpose() - Eigen::Matrix2d::Identity()) * r.m; // mirror across the edge
+            r.t = qp[c2] - r.m * q[v2];
+
+            fresh[f] = v1;
+            fresh_local[f] = q[v1];
+        }
+    }, 2048);
+
+    // every face must add a vertex no earlier face has, as UnwarpCylinder asserts
+    ParallelFor(nfaces - 1, [&](int begin, int end)
+    {
+        for (int f = begin + 1; f < end + 1 && strip.load(std::memory_order_relaxed); f++)
+            if (owner[F(f, fresh[f])].load(std::memory_order_relaxed) != f)
+                strip.store(false, std::memory_order_relaxed);
+    });
+    for (int c = 0; c < 3; c++)
+        if (owner[F(0, c)].load() != 0)
+            strip.store(false);
+    if (!strip.load())
+    {
+        UnwarpCylinder(V, F, Vuv);
+        return;
+    }
+
+    // phase 2, prefix scan: place[f] = place[f-1] o rel[f], with place[0] the identity. Blocks
+    // are scanned in parallel, then the block totals serially, then the offsets are applied.
+    constexpr int block = 4096;
+    const int nblocks = (nfaces + block - 1) / block;
+    ParallelFor(nblocks, [&](int begin, int end)
+    {
+        for (int k = begin; k < end; k++)
+            for (int f = k * block + 1; f < std::min(nfaces, (k + 1) * block); f++)
+                rel[f] = Compose(rel[f - 1], rel[f]);
+    }, 1);
+    std::vector<Rigid2> offset(nblocks);
+    for (int k = 1; k < nblocks; k++)
+        offset[k] = Compose(offset[k - 1], rel[k * block - 1]);
+
+    // phase 3: every vertex is placed by the face that adds it
+    Vuv = Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>::Zero(V.rows(), 3);
+    Eigen::Vector2d q0[3];
+    FaceLocal(V, F, 0, q0);
+    for (int c = 0; c < 3; c++)
+        Vuv.block<1, 2>(F(0, c), 0) = q0[c].transpose();
+    ParallelFor(nblocks, [&](int begin, int end)
+    {
+        for (int k = begin; k < end; k++)
+        {
+            for (int f = std::max(1, k * block); f < std::min(nfaces, (k + 1) * block); f++)
+            {
+                Rigid2 place = k == 0 ? rel[f] : Compose(offset[k], rel[f]);
+                Vuv.block<1, 2>(F(f, fresh[f]), 0) = (place.m * fresh_local[f] + place.t).transpose();
+            }
+        }
+    }, 1);
+}
+
+void UnwrapConeAnalytic(double r1, double r2, double h, int circle_res,
+                        Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>& V,
+                        Eigen::Matrix<int, Eigen::Dynamic, Eigen::Dynamic>& F,
+                        Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>& Vuv)
+{
+    std::vector<double> step_theta(V.rows() / 2);
+    for (int id = 0; id < (int)step_theta.size(); id++)
+        step_theta[id] = -2 * M_PI + id * 2 * M_PI / circle_res;
+    UnwrapConeAnalytic(r1, r2, h, step_theta, V, F, Vuv);
+}
 
+void UnwrapConeAnalytic(double r1, double r2, double h, const std::vector<double>& step_theta,
+                        Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>& V,
+                        Eigen::Matrix<int, Eigen::Dynamic, Eigen::Dynamic>& F,
+                        Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>& Vuv)
+{
+    Vuv = Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>::Zero(V.rows(), 3);
+    // no faces to orient the frame by, as in UnwarpCylinder; every vertex needs its step's theta
+    if (F.rows() == 0)
+        return;
+    assert((int)step_theta.size() >= (V.rows() + 1) / 2);
 
+    // a cone with slant length l develops into an annular sector: theta shrinks by |r1-r2|/l
+    // and the distance to the apex is kept; a cylinder (r1 == r2) develops into a rectangle
+    double slant = sqrt((r2 - r1) * (r2 - r1) + h * h);
+    bool cylinder = std::abs(r2 - r1) <= 1e-12 * slant;
+    double scale = std::abs(r2 - r1) / slant;
+    double apex_y = cylinder ? 0 : -r1 * h / (r2 - r1);
 
+    ParallelFor(V.rows(), [&](int begin, int end)
+    {
+        for (int i = begin; i < end; i++)
+        {
+            // both vertices of a strip rung share the azimuth of CreateCylinderWithCut's theta
+            // (the odd one is the same azimuth one turn higher), so the strip develops without seams
+            double theta = step_theta[i / 2];
 
+            if (cylinder)
+            {
+                Vuv(i, 0) = r1 * theta;
+                Vuv(i, 1) = V(i, 1);
+            }
+            else
+            {
+                double dy = V(i, 1) - apex_y;
+                double s = sqrt(V(i, 0) * V(i, 0) + V(i, 2) * V(i, 2) + dy * dy);
+                Vuv(i, 0) = s * cos(theta * scale);
+                Vuv(i, 1) = s * sin(theta * scale);
+            }
+        }
+    });
+
+    // same frame convention as UnwarpCylinder: F(0,0) at the origin, F(0,1) on +x and the strip
+    // counter-clockwise (checked on a middle face; the first and last faces are folded by epsilon_h)
+    int fmid = F.rows() / 2;
+    Eigen::Vector2d origin = Vuv.block<1, 2>(F(0, 0), 0).transpose();
+    Eigen::Vector2d u = (Vuv.block<1, 2>(F(0, 1), 0).transpose() - origin).normalized();
+    Eigen::Vector2d v(-u.y(), u.x());
+    Eigen::Vector2d e1 = (Vuv.block<1, 2>(F(fmid, 1), 0) - Vuv.block<1, 2>(F(fmid, 0), 0)).transpose();
+    Eigen::Vector2d e2 = (Vuv.block<1, 2>(F(fmid, 2), 0) - Vuv.block<1, 2>(F(fmid, 0), 0)).transpose();
+    if (e1.dot(u) * e2.dot(v) - e1.dot(v) * e2.dot(u) < 0)
+        v = -v;
+
+    ParallelFor(V.rows(), [&](int begin, int end)
+    {
+        for (int i = begin; i < end; i++)
+        {
+            Eigen::Vector2d p = Vuv.block<1, 2>(i, 0).transpose() - origin;
+            Vuv(i, 0) = p.dot(u);
+            Vuv(i, 1) = p.dot(v);
+        }
+    });
+}
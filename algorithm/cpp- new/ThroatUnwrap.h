@@ -1,6 +1,33 @@
 #pragma once
 #include <Eigen/Core>
 #include <vector>
+#include <span>
+#include <cmath>
+#include <functional>
+#include <array>
+#include <iostream>
+
+// Spiral cut parameters plus the constants SampleOnSpiral derives from them, computed once per
+// mesh so the per-sample code does no tan() and no division.
+struct SpiralParams
+{
+    double r1, r2, h, cut_angle;
+    bool equidistant;
+
+    double tan_cut; // tan(cut_angle), slope of h(theta) in equidistant mode
+    double c1, c2;  // ODE solution h(theta) = c2/c1 - c2/c1 * exp(-c1 * theta)
+    double c2_c1;   // c2 / c1
+    double dr_dh;   // (r2 - r1) / h, slope of r(h)
+
+    SpiralParams(double r1, double r2, double h, double cut_angle, bool equidistant);
+};
+
+// How CreateCylinderWithCut evaluates the spiral on its uniform theta grid
+enum class SpiralSampling
+{
+    Direct,     // SampleOnSpiralBatch: sin/cos/exp per sample (bit-identical to SampleOnSpiral)
+    Recurrence, // SampleOnSpiralRecurrence: rotation / geometric-progression updates, re-anchored
+};
 
 void CreateCylinderWithCut(double r1, double r2, double h,
                            Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>& V,
@@ -8,9 +35,185 @@ void CreateCylinderWithCut(double r1, double r2, double h,
                            Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>& P,
                            int circle_res, double cut_angle, bool equidistant,
                            std::vector<int> & edges, std::vector<int> & corrs);
+// A spiral truncated at the sample budget is reported as a [WARNING] line on log
+void CreateCylinderWithCut(const SpiralParams& spiral,
+                           Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>& V,
+                           Eigen::Matrix<int, Eigen::Dynamic, Eigen::Dynamic>& F,
+                           Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>& P,
+                           int circle_res, std::vector<int>& edges, std::vector<int>& corrs,
+                           SpiralSampling sampling = SpiralSampling::Direct, std::ostream& log = std::cout);
+// CreateCylinderWithCut with theta steps chosen from a chord tolerance instead of a fixed
+// circle_res: every step is as long as possible while the segments of both strip chains stay
+// within max_chord_error (cm) of the spiral, so the wide end of the throat gets more samples per
+// turn than the narrow end. The strip layout is CreateCylinderWithCut's (vertices 2*id and
+// 2*id+1 at theta and theta + 2pi), ending at the first sample clamped to h; step_theta
+// receives the theta of every step. Like CreateCylinderWithCut, it writes a [WARNING] line to
+// log when the spiral is truncated.
+void CreateCylinderWithCutAdaptive(const SpiralParams& spiral, double max_chord_error,
+                                   Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>& V,
+                                   Eigen::Matrix<int, Eigen::Dynamic, Eigen::Dynamic>& F,
+                                   Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>& P,
+                                   std::vector<int>& edges, std::vector<double>& step_theta,
+                                   std::ostream& log = std::cout);
+
+// Edge -> face adjacency of a triangle mesh. Edges are bucketed by their smaller
+// vertex index (CSR layout), so building is linear in the number of faces and a
+// lookup only scans the faces around one vertex.
+struct EdgeFaceAdjacency
+{
+    std::vector<int> offsets; // per vertex: first entry of its bucket (size nvertices+1)
+    std::vector<int> other;   // larger vertex index of the edge
+    std::vector<int> faces;   // face containing the edge
+    std::vector<int> corners; // local index (0..2) of the face vertex opposite the edge
+};
+
+void BuildEdgeFaceAdjacency(const Eigen::Matrix<int, Eigen::Dynamic, Eigen::Dynamic>& F, int nvertices,
+                            EdgeFaceAdjacency& adj);
+
+// Returns the lowest-index face below `before` that contains edge (va,vb), or -1.
+// `corner` receives the local index of that face's vertex opposite the edge.
+int FindAdjacentFace(const EdgeFaceAdjacency& adj, int va, int vb, int before, int& corner);
+
+// How UnwarpCylinder places the new vertex of a face against its already flattened edge
+enum class UnwrapPlacement
+{
+    Projection, // coordinates along / across the edge from a dot and a cross product, no trig
+    Trig,       // angle at the edge start from acos, then a cos/sin rotation of the edge direction
+};
+
+// Row-major mesh and UV buffers: one contiguous row per vertex / face
+template <typename Scalar>
+using MeshVertices = Eigen::Matrix<Scalar, Eigen::Dynamic, 3, Eigen::RowMajor>;
+using MeshFaces = Eigen::Matrix<int, Eigen::Dynamic, 3, Eigen::RowMajor>;
+template <typename Scalar>
+using UVBuffer = Eigen::Matrix<Scalar, Eigen::Dynamic, 2, Eigen::RowMajor>;
+
+// Unfolds F face by face, each face adding one vertex against an edge flattened before. Faces in
+// strip order (CreateCylinderWithCut) find that edge's face in O(1); other meshes build an
+// EdgeFaceAdjacency on the first face that needs it.
 void UnwarpCylinder(Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>& V,
                     Eigen::Matrix<int, Eigen::Dynamic, Eigen::Dynamic>& F,
-                    Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>& Vuv);
+                    Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>& Vuv,
+                    UnwrapPlacement placement = UnwrapPlacement::Projection);
+
+// UnwarpCylinder computing in Scalar and writing an N x 2 UV buffer. Instantiated for float and
+// double with the column-major V/F above or row-major MeshVertices/MeshFaces, whose rows the
+// unfolding loop reads contiguously. Float storage takes a third of the N x 3 double Vuv, but
+// rounding grows along the strip (see run_bench_unwrap_layout).
+template <typename Scalar, typename DerivedV, typename DerivedF>
+void UnwarpCylinder(const Eigen::MatrixBase<DerivedV>& V, const Eigen::MatrixBase<DerivedF>& F, UVBuffer<Scalar>& Vuv,
+                    UnwrapPlacement placement = UnwrapPlacement::Projection);
+
+// UnwarpCylinder for strip-ordered meshes (face f shares an edge with face f-1 and adds one new
+// vertex, as CreateCylinderWithCut emits them), in three parallel phases: each face computes its
+// own layout and the rigid 2D map into face f-1's layout, the maps are composed by a blocked
+// prefix scan, and every new vertex is placed by its face's composed map. Vuv matches
+// UnwarpCylinder up to rounding accumulated along the strip: within 1e-9 of the strip extent
+// (about 1e-10 cm on a 20 cm strip of 1M faces, see run_bench_unwrap_cylinder). Other meshes
+// fall back to UnwarpCylinder.
+void UnwarpCylinderParallel(Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>& V,
+                            Eigen::Matrix<int, Eigen::Dynamic, Eigen::Dynamic>& F,
+                            Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>& Vuv);
+
+// One chunk of StreamCylinderWithCut's output
+struct StripChunk
+{
+    int first_vertex;                 // index in V of the first vertex in uv
+    std::span<const double> uv;       // unfolded vertices (u, v) with consecutive indices from first_vertex
+    std::span<const double> segments; // cut lines (u0, v0, u1, v1) in the order of CreateCylinderWithCut's edges
+};
+
+// CreateCylinderWithCut (cut_angle != -1) followed by UnwarpCylinder without materializing the
+// mesh: steps are sampled and unfolded chunk_steps at a time and each chunk is handed to sink,
+// so memory stays O(chunk_steps) for any circle_res and number of turns. The unfolded vertices
+// (those of the generator's faces) and segments are bit-identical to the two-call path.
+// Warnings go to log as in CreateCylinderWithCut.
+void StreamCylinderWithCut(const SpiralParams& spiral, int circle_res, int chunk_steps,
+                           const std::function<void(const StripChunk&)>& sink,
+                           UnwrapPlacement placement = UnwrapPlacement::Projection, std::ostream& log = std::cout);
+
+// Throughput of one stage of StreamCylinderWithCutPipelined
+struct PipelineStageStats
+{
+    const char* name = "";
+    long long chunks = 0;
+    long long steps = 0;
+    double busy_ms = 0; // time spent on the stage's own work
+    double wait_ms = 0; // time blocked on an empty input or full output queue
+};
+
+// StreamCylinderWithCut with sampling and unfolding on two worker threads and sink on the
+// calling thread, connected by bounded lock-free queues of queue_chunks chunks each. Chunks
+// reach sink in order and bit-identical to StreamCylinderWithCut; stats gets the sample,
+// unfold and sink stages in that order. An exception from sink or a worker stops all three
+// stages and is rethrown after the workers are joined.
+void StreamCylinderWithCutPipelined(const SpiralParams& spiral, int circle_res, int chunk_steps,
+                                    const std::function<void(const StripChunk&)>& sink,
+                                    std::array<PipelineStageStats, 3>& stats, int queue_chunks = 4,
+                                    UnwrapPlacement placement = UnwrapPlacement::Projection,
+                                    std::ostream& log = std::cout);
 
 Eigen::Vector3d SampleOnSpiral(double r1, double r2, double h, double cut_angle,
-                               double theta, double & ch, double &cr, bool equidistant);
\ No newline at end of file
+                               double theta, double & ch, double &cr, bool equidistant);
+
+// SampleOnSpiral with the height function fixed at compile time; bit-identical to the above
+template <bool Equidistant>
+inline Eigen::Vector3d SampleOnSpiral(const SpiralParams& spiral, double theta, double& ch, double& cr)
+{
+    if constexpr (Equidistant)
+        ch = spiral.tan_cut * theta; // h(theta)
+    else
+        ch = spiral.c2_c1 - spiral.c2_c1 * exp(-spiral.c1 * theta);
+
+    if (ch < 0)
+        ch = 0;
+    else if (ch > spiral.h)
+        ch = spiral.h;
+    cr = spiral.r1 + spiral.dr_dh * ch; // r(h)
+
+    return Eigen::Vector3d(sin(theta) * cr, ch, cos(theta) * cr);
+}
+
+inline Eigen::Vector3d SampleOnSpiral(const SpiralParams& spiral, double theta, double& ch, double& cr)
+{
+    return spiral.equidistant ? SampleOnSpiral<true>(spiral, theta, ch, cr)
+                              : SampleOnSpiral<false>(spiral, theta, ch, cr);
+}
+
+// SampleOnSpiral for a whole span of thetas, written as structure-of-arrays (x, y, z, ch, cr must
+// be at least theta.size() long). Built with AVX2+FMA or AVX-512 (THROAT_UNWRAP_SIMD) it runs
+// vectorized sin/cos/exp kernels accurate to a few ulp; otherwise it is bit-identical to
+// SampleOnSpiral.
+void SampleOnSpiralBatch(double r1, double r2, double h, double cut_angle, bool equidistant,
+                         std::span<const double> theta, std::span<double> x, std::span<double> y,
+                         std::span<double> z, std::span<double> ch, std::span<double> cr);
+void SampleOnSpiralBatch(const SpiralParams& spiral, std::span<const double> theta, std::span<double> x,
+                         std::span<double> y, std::span<double> z, std::span<double> ch, std::span<double> cr);
+
+// Samples the uniform grid theta0 + k * dtheta (k < x.size()) without per-sample
+// transcendentals: (cos, sin) advance by a complex rotation by dtheta and exp(-c1 * theta) by the
+// constant ratio exp(-c1 * dtheta). Every `anchor` samples both restart from directly evaluated
+// values, which bounds the drift; with the default of 64 the positions stay within ~1e-14 of
+// SampleOnSpiral relative to the radius (see run_bench_spiral_recurrence). anchor < 1 is taken
+// as 1, i.e. every sample evaluated directly.
+void SampleOnSpiralRecurrence(const SpiralParams& spiral, double theta0, double dtheta, std::span<double> x,
+                              std::span<double> y, std::span<double> z, std::span<double> ch,
+                              std::span<double> cr, int anchor = 64);
+
+// Number of doubles SampleOnSpiralBatch processes per vector (1 for the scalar build)
+int SpiralBatchLanes();
+
+// Develops the conical frustum produced by CreateCylinderWithCut (cut_angle != -1) into the
+// plane in closed form: each vertex maps to polar coordinates (slant distance from the apex,
+// theta scaled by the cone's opening) without any per-face dependency, so vertices are
+// processed in parallel. Vertex thetas follow the generator's layout for circle_res, or are
+// given per step (vertices 2*id and 2*id+1) for the adaptive generator.
+// Vuv is expressed in UnwarpCylinder's frame (F(0,0) at the origin, F(0,1) on +x).
+void UnwrapConeAnalytic(double r1, double r2, double h, int circle_res,
+                        Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>& V,
+                        Eigen::Matrix<int, Eigen::Dynamic, Eigen::Dynamic>& F,
+                        Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>& Vuv);
+void UnwrapConeAnalytic(double r1, double r2, double h, const std::vector<double>& step_theta,
+                        Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>& V,
+                        Eigen::Matrix<int, Eigen::Dynamic, Eigen::Dynamic>& F,
+                        Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>& Vuv);
\ No newline at end of file
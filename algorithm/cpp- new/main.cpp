@@ -10,12 +10,26 @@
 
 #include <memory>
 #include <algorithm>
+#include <limits>
+#include <map>
+#include <set>
 #include <cstdlib>
 #include <fstream>
+#include <sstream>
 #include <filesystem>
+#include <chrono>
+#include <thread>
+#include <zlib.h>
 namespace fs = std::filesystem;
 
 #include "ThroatUnwrap.h"
+#include "TemplateWriter.h"
+#include "PathOrder.h"
+#include "PageTiling.h"
+#include "Nesting.h"
+#include "Simplify.h"
+#include "BezierFit.h"
+#include "Batch.h"
 
 
 Eigen::MatrixXd V, P, Vuv;
@@ -33,6 +47,31 @@ bool showpoints = false;
 bool showembedding = false;
 bool init_show_wireframe = false;
 bool equidistant = false;
+double chord_error = 0; // > 0: adaptive sampling with this max chord deviation (cm) instead of cir_res
+bool stream = false; // generate, unwrap and write in chunks without keeping the mesh
+bool pipeline = false; // -stream with sampling, unwrapping and writing on separate threads
+int precision = 3; // decimals of the written coordinates (points)
+PageSize page_size = PageSize::A4;
+bool optimize_travel = false; // order and orient the paths for the least pen-up travel
+double tile_overlap = 1; // cm shared by neighbouring pages of a tiled layout
+const double tile_margin = 18; // unprinted page border (points) of a tiled layout
+std::vector<std::array<double, 4>> nest_templates; // -nest: more templates (c1, c2, h, angle) to pack with this one
+const double nest_gap = 0.3; // cm between nested templates
+double simplify_tolerance = 0; // mm; > 0: drop cut line vertices the simplified lines pass within this distance of
+double bezier_tolerance = 0; // mm; > 0: write the cut lines as cubic Beziers within this distance (PS/PDF/SVG)
+int batch_threads = (int)std::max(1u, std::thread::hardware_concurrency()); // -batch worker threads
+std::string batch_manifest = "manifest.csv"; // -batch summary
+bool landscape = false;
+
+// Whether two -nest templates (c1, c2, h, angle) are the same up to the rounding of their
+// inputs; the sampling options are shared, so equal inputs give equal outlines
+bool SameTemplate(const std::array<double, 4>& a, const std::array<double, 4>& b)
+{
+    for (int i = 0; i < 4; i++)
+        if (std::abs(a[i] - b[i]) > 1e-9 * std::max({1.0, std::abs(a[i]), std::abs(b[i])}))
+            return false;
+    return true;
+}
 
 // void MeshUpdate()
 // {
@@ -163,6 +202,15 @@ struct TestParams
     bool equidistant;
 };
 
+// Writes a check of a test as "name: true/false" and reports a failed one on the console
+bool CheckResult(std::ofstream& outfile, const std::string& file_path, const std::string& name, bool ok)
+{
+    outfile << name << ": " << (ok ? "true" : "false") << std::endl;
+    if (!ok)
+        std::cout << "[ERROR] " << file_path << ": " << name << " failed" << std::endl;
+    return ok;
+}
+
 // TEST FUNCTION ------------------------------------------------------
 void test_SampleOnSpiral(const std::string& file_path, TestParams& params)
 {
@@ -420,91 +468,3277 @@ void run_test_unwrap_cylinder()
     test_UnwarpCylinder(file_path3, params3);
 }
 
+// Largest distance between two layouts of the same mesh after the best rigid alignment
+// (2D Procrustes, rotation only) of b onto a over the face vertices
+double AlignedDeviation(const Eigen::MatrixXd& a, const Eigen::MatrixXd& b, const Eigen::MatrixXi& F)
+{
+    Eigen::Vector2d ca(0, 0), cb(0, 0);
+    for (int i = 0; i < F.size(); i++)
+    {
+        ca += a.block<1, 2>(F(i), 0).transpose();
+        cb += b.block<1, 2>(F(i), 0).transpose();
+    }
+    ca /= F.size();
+    cb /= F.size();
+    double sdot = 0, scross = 0;
+    for (int i = 0; i < F.size(); i++)
+    {
+        Eigen::Vector2d pa = a.block<1, 2>(F(i), 0).transpose() - ca;
+        Eigen::Vector2d pb = b.block<1, 2>(F(i), 0).transpose() - cb;
+        sdot += pa.dot(pb);
+        scross += pb.x() * pa.y() - pb.y() * pa.x();
+    }
+    double angle = atan2(scross, sdot);
+    double max_dev = 0;
+    for (int i = 0; i < F.size(); i++)
+    {
+        Eigen::Vector2d pb = b.block<1, 2>(F(i), 0).transpose() - cb;
+        Eigen::Vector2d rb(cos(angle) * pb.x() - sin(angle) * pb.y(), sin(angle) * pb.x() + cos(angle) * pb.y());
+        max_dev = std::max(max_dev, (rb + ca - a.block<1, 2>(F(i), 0).transpose()).norm());
+    }
+    return max_dev;
+}
 
-// Main function for testing the app
-// int main(int argc, char* argv[])
-// {
-//     run_test_on_spiral();
-//     run_test_create_cylinder();
-//     run_test_unwrap_cylinder();
-// }
+// Compares UnwrapConeAnalytic with UnwarpCylinder on the same mesh. The two layouts are compared
+// after the best rigid alignment of the face vertices (both start from F(0,0) / F(0,1), but the
+// serial unfolder's heading drifts over long strips).
+//
+// The drift comes from epsilon_h: CreateCylinderWithCut lowers the cut side by h / 100, which
+// takes those vertices off the cone (unless r1 == r2), so the faceted strip is not developable
+// and the deviation grows linearly with epsilon_h (0.3-0.7 mm here). With the cut side raised
+// back onto the cone the two layouts agree to the faceting error, O(1 / circle_res^2): the test
+// checks that one against 1e-3 of the layout's extent.
+void test_UnwrapConeAnalytic(const std::string& file_path, const TestParams& params)
+{
+    Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> V, P, Vuv, Vcone;
+    Eigen::Matrix<int, Eigen::Dynamic, Eigen::Dynamic> F;
+    std::vector<int> edges, corrs;
 
+    CreateCylinderWithCut(params.r1, params.r2, params.h, V, F, P, params.cir_res, params.cut_angle, params.equidistant,
+                          edges, corrs);
+    UnwarpCylinder(V, F, Vuv);
+    UnwrapConeAnalytic(params.r1, params.r2, params.h, params.cir_res, V, F, Vcone);
+    double max_dev = AlignedDeviation(Vuv, Vcone, F);
 
-// Main App
-int main(int argc, char* argv[])
-{
-    std::string outfile = "test.ps";
-    if (argc < 6)
+    Eigen::MatrixXd Von = V, Vuv_on, Vcone_on;
+    for (int i = 1; i < Von.rows(); i += 2)
+        Von(i, 1) += params.h / 100;
+    UnwarpCylinder(Von, F, Vuv_on);
+    UnwrapConeAnalytic(params.r1, params.r2, params.h, params.cir_res, Von, F, Vcone_on);
+    double on_cone_dev = AlignedDeviation(Vuv_on, Vcone_on, F);
+
+    // a strip without faces leaves both layouts at the origin instead of reading face 0
+    Eigen::MatrixXd V_empty = V.topRows(2), Vuv_empty, Vcone_empty;
+    Eigen::MatrixXi F_empty(0, 3);
+    UnwarpCylinder(V_empty, F_empty, Vuv_empty);
+    UnwrapConeAnalytic(params.r1, params.r2, params.h, std::vector<double>{0}, V_empty, F_empty, Vcone_empty);
+    bool empty_ok = Vuv_empty.rows() == 2 && Vcone_empty.rows() == 2 && Vuv_empty.isZero() && Vcone_empty.isZero();
+
+    double extent = (Vuv.colwise().maxCoeff() - Vuv.colwise().minCoeff()).norm();
+
+    std::filesystem::path dir = file_path.substr(0, file_path.find_last_of('/'));
+    if (!std::filesystem::exists(dir))
     {
-        std::cout << "Use: " << argv[0] << " circumference1 curcumference2 height cut_angle outputfile " << std::endl;
-        std::cout << "     -equidistant -- test this flag" << std::endl;
-        std::cout << "     NOTE: all units are centimeters, cut angle is in degrees" << std::endl;
+        std::filesystem::create_directories(dir);
     }
-    else
+
+    std::ofstream outfile(file_path);
+    if (!outfile.is_open())
+    {
+        std::cerr << "Error: Could not open file " << file_path << " for writing." << std::endl;
+        return;
+    }
+
+    outfile << "Test Parameters:" << std::endl;
+    outfile << "r1: " << params.r1 << std::endl;
+    outfile << "r2: " << params.r2 << std::endl;
+    outfile << "h: " << params.h << std::endl;
+    outfile << "circle_res: " << params.cir_res << std::endl;
+    outfile << "cut_angle: " << params.cut_angle << std::endl;
+    outfile << "equidistant: " << (params.equidistant ? "true" : "false") << std::endl;
+    outfile << std::endl;
+
+    outfile << "Outputs:" << std::endl;
+    outfile << "extent: " << extent << std::endl;
+    outfile << "max deviation from UnwarpCylinder: " << max_dev << std::endl;
+    outfile << "max deviation with the cut side on the cone: " << on_cone_dev << std::endl;
+    CheckResult(outfile, file_path, "on-cone deviation within 1e-3 of the extent", on_cone_dev <= 1e-3 * extent);
+    CheckResult(outfile, file_path, "empty mesh handled", empty_ok);
+    outfile << std::endl;
+
+    outfile << "Unwrapped Vertices (Vcone):" << std::endl;
+    for (int i = 0; i < Vcone.rows(); ++i)
     {
-        r1 = atof(argv[1]) / (2 * M_PI);
-        r2 = atof(argv[2]) / (2 * M_PI);
-        h = atof(argv[3]);
-        cut_angle = atof(argv[4]) / 180 * M_PI;
-        outfile = argv[5];
+        outfile << Vcone(i, 0) << " " << Vcone(i, 1) << " " << Vcone(i, 2) << std::endl;
+    }
+    outfile << std::endl;
+
+    outfile.close();
+    std::cout << "Test results saved to " << file_path << std::endl;
+}
+
+void run_test_unwrap_cone_analytic()
+{
+    constexpr TestParams params1 = {1.0, 0.8, 2.0, 100, M_PI / 4, 0.0, 0.0, 0.0, true};
+    const std::string file_path1 = "../results/test_UnwrapConeAnalytic_1.txt";
+    test_UnwrapConeAnalytic(file_path1, params1);
+
+    constexpr TestParams params2 = {2.0, 1.5, 3.0, 150, M_PI / 6, 0.0, 0.0, 0.0, false};
+    const std::string file_path2 = "../results/test_UnwrapConeAnalytic_2.txt";
+    test_UnwrapConeAnalytic(file_path2, params2);
 
-        for (int i = 6; i < argc; i++)
+    constexpr TestParams params3 = {1.5, 1.2, 2.5, 120, M_PI / 3, 0.0, 0.0, 0.0, true};
+    const std::string file_path3 = "../results/test_UnwrapConeAnalytic_3.txt";
+    test_UnwrapConeAnalytic(file_path3, params3);
+}
+
+// Largest distance between the spiral and the chords of both strip chains, over the face steps
+// (dense sampling of every segment)
+double MaxChordDeviation(const SpiralParams& spiral, const std::vector<double>& step_theta, int nsteps)
+{
+    double max_dev = 0;
+    for (int i = 0; i + 1 < nsteps; i++)
+    {
+        for (double turn : {0.0, 2 * M_PI})
         {
-            if (strcmp(argv[i], "-equidistant"))
-                equidistant = true;
-            else
-                std::cout << "[WARNING] Unknown command: " << argv[i] << std::endl;
+            double a = step_theta[i] + turn, b = step_theta[i + 1] + turn, ch, cr;
+            Eigen::Vector3d pa = SampleOnSpiral(spiral, a, ch, cr);
+            Eigen::Vector3d d = SampleOnSpiral(spiral, b, ch, cr) - pa;
+            for (int k = 1; k < 16; k++)
+            {
+                Eigen::Vector3d q = SampleOnSpiral(spiral, a + k * (b - a) / 16, ch, cr) - pa;
+                max_dev = std::max(max_dev, (q - q.dot(d) / d.squaredNorm() * d).norm());
+            }
         }
     }
-    std::vector<int> edges, corrs;
+    return max_dev;
+}
 
-    std::cout << "r1: " << r1 << std::endl;
-    std::cout << "r2: " << r2 << std::endl;
-    std::cout << "h: " << h << std::endl;
-    std::cout << "cut_angle: " << cut_angle << std::endl;
-    std::cout << "equidistant: " << equidistant << std::endl;
-    std::cout << "outfile: " << outfile << std::endl;
+void test_CreateCylinderWithCutAdaptive(const std::string& file_path, const TestParams& params,
+                                        double max_chord_error)
+{
+    Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> V, P, Vuv;
+    Eigen::Matrix<int, Eigen::Dynamic, Eigen::Dynamic> F;
+    std::vector<int> edges;
+    std::vector<double> step_theta;
 
-    CreateCylinderWithCut(r1, r2, h, V, F, P, cir_res, cut_angle, equidistant, edges, corrs);
+    const SpiralParams spiral(params.r1, params.r2, params.h, params.cut_angle, params.equidistant);
+    CreateCylinderWithCutAdaptive(spiral, max_chord_error, V, F, P, edges, step_theta);
     UnwarpCylinder(V, F, Vuv);
 
-    int width = 595; //210;
-    int height = 842; //297;
-    double cm2pxw = 10 * width / 210.;
-    double cm2pxh = 10 * height / 297.;
-    double minx = Vuv.col(0).minCoeff();
-    double maxx = Vuv.col(0).maxCoeff();
-    double miny = Vuv.col(1).minCoeff();
-    double maxy = Vuv.col(1).maxCoeff();
+    std::filesystem::path dir = file_path.substr(0, file_path.find_last_of('/'));
+    if (!std::filesystem::exists(dir))
+    {
+        std::filesystem::create_directories(dir);
+    }
 
-    if (maxx - minx >= width || maxy - miny >= height)
+    std::ofstream outfile(file_path);
+    if (!outfile.is_open())
     {
-        std::cout << "[ERROR] Cannot fit " << (maxx - minx) << "x" << (maxy - miny) << " cutout ";
-        std::cout << " on " << width << "x" << height << " paper " << std::endl;
+        std::cerr << "Error: Could not open file " << file_path << " for writing." << std::endl;
+        return;
     }
-    else
+
+    outfile << "Test Parameters:" << std::endl;
+    outfile << "r1: " << params.r1 << std::endl;
+    outfile << "r2: " << params.r2 << std::endl;
+    outfile << "h: " << params.h << std::endl;
+    outfile << "max_chord_error: " << max_chord_error << std::endl;
+    outfile << "cut_angle: " << params.cut_angle << std::endl;
+    outfile << "equidistant: " << (params.equidistant ? "true" : "false") << std::endl;
+    outfile << std::endl;
+
+    outfile << "Outputs:" << std::endl;
+    outfile << "steps: " << step_theta.size() << std::endl;
+    outfile << "faces: " << F.rows() << std::endl;
+    const double deviation = MaxChordDeviation(spiral, step_theta, F.rows() / 2 + 1);
+    outfile << "max chord deviation: " << deviation << std::endl;
+    // the first guess puts the sagitta of a circular chain exactly at the tolerance, so allow rounding
+    CheckResult(outfile, file_path, "within max_chord_error", deviation <= max_chord_error * (1 + 1e-12));
+    outfile << "unwrapped: " << (Vuv.hasNaN() ? "false" : "true") << std::endl;
+    outfile << std::endl;
+
+    outfile << "Step thetas:" << std::endl;
+    for (double theta : step_theta)
+    {
+        outfile << theta << std::endl;
+    }
+    outfile << std::endl;
+
+    outfile << "Unwrapped Vertices (Vuv):" << std::endl;
+    for (int i = 0; i < Vuv.rows(); ++i)
     {
-        std::ofstream textStream(outfile.c_str());
-        textStream << "0 0 moveto\n";
-        textStream << width << " 0 lineto\n"; // horizontal bar
-        textStream << width << " 0 closepath\n"; // horizontal bar
-        textStream << "0 0 moveto\n";
-        textStream << 0 << " " << height << " lineto\n"; // veritcal bar
-        textStream << 0 << " " << height << " closepath\n"; // veritcal bar
+        outfile << Vuv(i, 0) << " " << Vuv(i, 1) << std::endl;
+    }
+    outfile << std::endl;
 
-        double offset = 5;
-        for (int i = 0; i < (int)edges.size(); i += 2)
+    outfile.close();
+    std::cout << "Test results saved to " << file_path << std::endl;
+}
+
+void test_BuildPolylines(const std::string& file_path, const TestParams& params)
+{
+    Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> V, P, Vuv;
+    Eigen::Matrix<int, Eigen::Dynamic, Eigen::Dynamic> F;
+    std::vector<int> edges, corrs;
+
+    const SpiralParams spiral(params.r1, params.r2, params.h, params.cut_angle, params.equidistant);
+    CreateCylinderWithCut(spiral, V, F, P, (int)params.cir_res, edges, corrs);
+    UnwarpCylinder(V, F, Vuv);
+    std::vector<int> vertices, starts;
+    BuildPolylines(edges, (int)V.rows(), vertices, starts);
+
+    // the streamed segments, joined in chunks of 7 steps, must give the same polylines
+    std::vector<std::vector<double>> joined;
+    {
+        PolylineJoiner joiner([&](std::span<const double> xy) { joined.emplace_back(xy.begin(), xy.end()); });
+        StreamCylinderWithCut(spiral, (int)params.cir_res, 7, [&](const StripChunk& chunk)
         {
-            double x0 = (offset + (Vuv(edges[i], 0) - minx) * cm2pxw);
-            double x1 = (offset + (Vuv(edges[i + 1], 0) - minx) * cm2pxw);
-            double y0 = (offset + (Vuv(edges[i], 1) - miny) * cm2pxh);
-            double y1 = (offset + (Vuv(edges[i + 1], 1) - miny) * cm2pxh);
-            textStream << x0 << " " << y0 << " moveto\n";
-            textStream << x1 << " " << y1 << " lineto\n";
-            textStream << x1 << " " << y1 << " closepath\n";;
-        }
-        textStream << "0 setlinewidth stroke\n";
-        textStream << "showpage\n";
+            for (size_t i = 0; i < chunk.segments.size(); i += 4)
+                joiner.Segment(chunk.segments[i], chunk.segments[i + 1], chunk.segments[i + 2], chunk.segments[i + 3]);
+        });
+    }
+    bool joiner_matches = joined.size() == starts.size() - 1;
+    for (size_t k = 0; joiner_matches && k < joined.size(); k++)
+    {
+        joiner_matches = (int)joined[k].size() == 2 * (starts[k + 1] - starts[k]);
+        for (int i = starts[k]; joiner_matches && i < starts[k + 1]; i++)
+            joiner_matches = joined[k][2 * (i - starts[k])] == Vuv(vertices[i], 0) &&
+                joined[k][2 * (i - starts[k]) + 1] == Vuv(vertices[i], 1);
+    }
+
+    std::filesystem::path dir = file_path.substr(0, file_path.find_last_of('/'));
+    if (!std::filesystem::exists(dir))
+    {
+        std::filesystem::create_directories(dir);
+    }
+
+    std::ofstream outfile(file_path);
+    if (!outfile.is_open())
+    {
+        std::cerr << "Error: Could not open file " << file_path << " for writing." << std::endl;
+        return;
+    }
+
+    outfile << "Test Parameters:" << std::endl;
+    outfile << "r1: " << params.r1 << std::endl;
+    outfile << "r2: " << params.r2 << std::endl;
+    outfile << "h: " << params.h << std::endl;
+    outfile << "cir_res: " << params.cir_res << std::endl;
+    outfile << "cut_angle: " << params.cut_angle << std::endl;
+    outfile << "equidistant: " << (params.equidistant ? "true" : "false") << std::endl;
+    outfile << std::endl;
+
+    outfile << "Outputs:" << std::endl;
+    outfile << "edges: " << edges.size() / 2 << std::endl;
+    outfile << "polylines: " << starts.size() - 1 << std::endl;
+    outfile << "joiner matches: " << (joiner_matches ? "true" : "false") << std::endl;
+    outfile << std::endl;
+
+    outfile << "Polylines (vertex count: vertices):" << std::endl;
+    for (size_t k = 0; k + 1 < starts.size(); k++)
+    {
+        outfile << starts[k + 1] - starts[k] << ":";
+        for (int i = starts[k]; i < starts[k + 1]; i++)
+            outfile << " " << vertices[i];
+        outfile << std::endl;
+    }
+    outfile << std::endl;
+
+    outfile.close();
+    std::cout << "Test results saved to " << file_path << std::endl;
+}
+
+void run_test_build_polylines()
+{
+    constexpr TestParams params1 = {1.0, 0.8, 2.0, 100, M_PI / 4, 0.0, 0.0, 0.0, true};
+    const std::string file_path1 = "../results/test_BuildPolylines_1.txt";
+    test_BuildPolylines(file_path1, params1);
+
+    constexpr TestParams params2 = {2.0, 1.5, 3.0, 150, M_PI / 6, 0.0, 0.0, 0.0, false};
+    const std::string file_path2 = "../results/test_BuildPolylines_2.txt";
+    test_BuildPolylines(file_path2, params2);
+
+    constexpr TestParams params3 = {3.0, 1.5, 5.0, 500, M_PI / 4, 0.0, 0.0, 0.0, false};
+    const std::string file_path3 = "../results/test_BuildPolylines_3.txt";
+    test_BuildPolylines(file_path3, params3);
+}
+
+void run_test_create_cylinder_adaptive()
+{
+    constexpr TestParams params1 = {1.0, 0.8, 2.0, 0, M_PI / 4, 0.0, 0.0, 0.0, true};
+    const std::string file_path1 = "../results/test_CreateCylinderWithCutAdaptive_1.txt";
+    test_CreateCylinderWithCutAdaptive(file_path1, params1, 0.01);
+
+    constexpr TestParams params2 = {2.0, 1.5, 3.0, 0, M_PI / 6, 0.0, 0.0, 0.0, false};
+    const std::string file_path2 = "../results/test_CreateCylinderWithCutAdaptive_2.txt";
+    test_CreateCylinderWithCutAdaptive(file_path2, params2, 0.01);
+
+    constexpr TestParams params3 = {3.0, 1.5, 5.0, 0, M_PI / 4, 0.0, 0.0, 0.0, false};
+    const std::string file_path3 = "../results/test_CreateCylinderWithCutAdaptive_3.txt";
+    test_CreateCylinderWithCutAdaptive(file_path3, params3, 0.001);
+}
+
+// SampleOnSpiralRecurrence against SampleOnSpiral over 20 turns at params.cir_res samples per
+// turn: within 1e-12 of the radius at the default anchor, and identical when anchor <= 1 (every
+// sample evaluated directly; 0 and negative anchors must not divide by zero)
+void test_SampleOnSpiralRecurrence(const std::string& file_path, const TestParams& params)
+{
+    const SpiralParams spiral(params.r1, params.r2, params.h, params.cut_angle, params.equidistant);
+    const int n = 20 * (int)params.cir_res;
+    const double dtheta = 2 * M_PI / params.cir_res;
+    std::vector<Eigen::Vector3d> ref(n);
+    for (int k = 0; k < n; k++)
+    {
+        double ch, cr;
+        ref[k] = SampleOnSpiral(spiral, -2 * M_PI + k * dtheta, ch, cr);
+    }
+    auto max_deviation = [&](int anchor)
+    {
+        std::vector<double> x(n), y(n), z(n), ch(n), cr(n);
+        SampleOnSpiralRecurrence(spiral, -2 * M_PI, dtheta, x, y, z, ch, cr, anchor);
+        double dev = 0;
+        for (int k = 0; k < n; k++)
+            dev = std::max(dev, (ref[k] - Eigen::Vector3d(x[k], y[k], z[k])).cwiseAbs().maxCoeff());
+        return dev;
+    };
+    double dev64 = max_deviation(64), dev1 = max_deviation(1), dev0 = max_deviation(0), dev_neg = max_deviation(-5);
+
+    std::filesystem::path dir = file_path.substr(0, file_path.find_last_of('/'));
+    if (!std::filesystem::exists(dir))
+    {
+        std::filesystem::create_directories(dir);
+    }
+
+    std::ofstream outfile(file_path);
+    if (!outfile.is_open())
+    {
+        std::cerr << "Error: Could not open file " << file_path << " for writing." << std::endl;
+        return;
+    }
+
+    outfile << "Test Parameters:" << std::endl;
+    outfile << "r1: " << params.r1 << std::endl;
+    outfile << "r2: " << params.r2 << std::endl;
+    outfile << "h: " << params.h << std::endl;
+    outfile << "cir_res: " << params.cir_res << std::endl;
+    outfile << "cut_angle: " << params.cut_angle << std::endl;
+    outfile << "equidistant: " << (params.equidistant ? "true" : "false") << std::endl;
+    outfile << std::endl;
+
+    outfile << "Outputs:" << std::endl;
+    outfile << "samples: " << n << std::endl;
+    outfile << "max deviation, anchor 64: " << dev64 << std::endl;
+    CheckResult(outfile, file_path, "anchor 64 within 1e-12 of the radius",
+                dev64 <= 1e-12 * std::max(params.r1, params.r2));
+    CheckResult(outfile, file_path, "anchor 1 identical", dev1 == 0);
+    CheckResult(outfile, file_path, "anchor 0 identical", dev0 == 0);
+    CheckResult(outfile, file_path, "anchor -5 identical", dev_neg == 0);
+
+    outfile.close();
+    std::cout << "Test results saved to " << file_path << std::endl;
+}
+
+void run_test_spiral_recurrence()
+{
+    constexpr TestParams params1 = {3.0, 1.5, 50.0, 500, M_PI / 4, 0.0, 0.0, 0.0, true};
+    const std::string file_path1 = "../results/test_SampleOnSpiralRecurrence_1.txt";
+    test_SampleOnSpiralRecurrence(file_path1, params1);
+
+    constexpr TestParams params2 = {3.0, 1.5, 5.0, 500, M_PI / 4, 0.0, 0.0, 0.0, false};
+    const std::string file_path2 = "../results/test_SampleOnSpiralRecurrence_2.txt";
+    test_SampleOnSpiralRecurrence(file_path2, params2);
+}
+
+// StreamCylinderWithCutPipelined against StreamCylinderWithCut, and with a sink that throws on
+// its third chunk: the exception must reach the caller (the workers are stopped and joined
+// first, not left running into std::terminate) and the sink must not be called again
+void test_StreamCylinderWithCutPipelined(const std::string& file_path, const TestParams& params)
+{
+    const SpiralParams spiral(params.r1, params.r2, params.h, params.cut_angle, params.equidistant);
+    const int chunk_steps = 64;
+    std::vector<double> serial_uv, serial_segments, piped_uv, piped_segments;
+    StreamCylinderWithCut(spiral, (int)params.cir_res, chunk_steps, [&](const StripChunk& chunk)
+    {
+        serial_uv.insert(serial_uv.end(), chunk.uv.begin(), chunk.uv.end());
+        serial_segments.insert(serial_segments.end(), chunk.segments.begin(), chunk.segments.end());
+    });
+    std::array<PipelineStageStats, 3> stats;
+    StreamCylinderWithCutPipelined(spiral, (int)params.cir_res, chunk_steps, [&](const StripChunk& chunk)
+    {
+        piped_uv.insert(piped_uv.end(), chunk.uv.begin(), chunk.uv.end());
+        piped_segments.insert(piped_segments.end(), chunk.segments.begin(), chunk.segments.end());
+    }, stats);
+
+    // one-chunk queues, so both workers are blocked on a full queue when the sink throws
+    int calls = 0;
+    std::string caught;
+    try
+    {
+        StreamCylinderWithCutPipelined(spiral, (int)params.cir_res, chunk_steps, [&](const StripChunk&)
+        {
+            if (++calls == 3)
+                throw std::runtime_error("sink failed");
+        }, stats, 1);
+    }
+    catch (const std::runtime_error& e)
+    {
+        caught = e.what();
+    }
+
+    std::filesystem::path dir = file_path.substr(0, file_path.find_last_of('/'));
+    if (!std::filesystem::exists(dir))
+    {
+        std::filesystem::create_directories(dir);
+    }
+
+    std::ofstream outfile(file_path);
+    if (!outfile.is_open())
+    {
+        std::cerr << "Error: Could not open file " << file_path << " for writing." << std::endl;
+        return;
+    }
+
+    outfile << "Test Parameters:" << std::endl;
+    outfile << "r1: " << params.r1 << std::endl;
+    outfile << "r2: " << params.r2 << std::endl;
+    outfile << "h: " << params.h << std::endl;
+    outfile << "cir_res: " << params.cir_res << std::endl;
+    outfile << "cut_angle: " << params.cut_angle << std::endl;
+    outfile << "equidistant: " << (params.equidistant ? "true" : "false") << std::endl;
+    outfile << "chunk_steps: " << chunk_steps << std::endl;
+    outfile << std::endl;
+
+    outfile << "Outputs:" << std::endl;
+    outfile << "unfolded vertices: " << serial_uv.size() / 2 << std::endl;
+    outfile << "segments: " << serial_segments.size() / 4 << std::endl;
+    CheckResult(outfile, file_path, "pipelined identical to serial",
+                piped_uv == serial_uv && piped_segments == serial_segments);
+    outfile << "throwing sink: " << (caught.empty() ? "no exception" : caught) << " after " << calls << " calls"
+        << std::endl;
+    CheckResult(outfile, file_path, "sink exception rethrown", caught == "sink failed");
+    CheckResult(outfile, file_path, "no sink call after the exception", calls == 3);
+
+    outfile.close();
+    std::cout << "Test results saved to " << file_path << std::endl;
+}
+
+void run_test_stream_pipelined()
+{
+    constexpr TestParams params1 = {3.0, 1.5, 5.0, 1000, M_PI / 4, 0.0, 0.0, 0.0, false};
+    const std::string file_path1 = "../results/test_StreamCylinderWithCutPipelined_1.txt";
+    test_StreamCylinderWithCutPipelined(file_path1, params1);
+
+    constexpr TestParams params2 = {2.0, 1.5, 30.0, 500, M_PI / 6, 0.0, 0.0, 0.0, true};
+    const std::string file_path2 = "../results/test_StreamCylinderWithCutPipelined_2.txt";
+    test_StreamCylinderWithCutPipelined(file_path2, params2);
+}
+
+// Cut lines of a test template as polylines in points, scaled like the CLI's A4 output
+// (1 cm = 10 * 595 / 210 pt) and moved to a 36 pt margin
+PolylineSet TestTemplatePolylines(const TestParams& params)
+{
+    Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> V, P, Vuv;
+    Eigen::Matrix<int, Eigen::Dynamic, Eigen::Dynamic> F;
+    std::vector<int> edges, corrs;
+    CreateCylinderWithCut(SpiralParams(params.r1, params.r2, params.h, params.cut_angle, params.equidistant), V, F, P,
+                          (int)params.cir_res, edges, corrs);
+    UnwarpCylinder(V, F, Vuv);
+    Vuv *= 10 * 595 / 210.;
+    const double min_x = Vuv.col(0).minCoeff(), min_y = Vuv.col(1).minCoeff();
+    std::vector<int> vertices, starts;
+    BuildPolylines(edges, (int)V.rows(), vertices, starts);
+
+    PolylineSet paths;
+    for (size_t k = 0; k + 1 < starts.size(); k++)
+    {
+        paths.NewPolyline();
+        for (int i = starts[k]; i < starts[k + 1]; i++)
+            paths.Append(Vuv(vertices[i], 0) - min_x + 36, Vuv(vertices[i], 1) - min_y + 36);
     }
+    return paths;
 }
 
+std::string ReadFileBytes(const std::string& path)
+{
+    std::ifstream in(path, std::ios::binary);
+    std::stringstream ss;
+    ss << in.rdbuf();
+    return ss.str();
+}
+
+// PdfWriter output read back: every xref entry must point at its "k 0 obj", startxref at the
+// xref table, and every content stream's /Length object at its "endstream"; the inflated
+// streams must stroke each polyline once per page
+void test_PdfWriter(const std::string& file_path, const TestParams& params)
+{
+    const PolylineSet paths = TestTemplatePolylines(params);
+    const std::string pdf_path = (std::filesystem::temp_directory_path() / "test_pdf_writer.pdf").string();
+    {
+        PdfWriter pdf(pdf_path, 595, 842);
+        for (int page = 0; page < 2; page++)
+        {
+            if (page > 0)
+                pdf.NewPage();
+            for (int k = 0; k < paths.Count(); k++)
+                pdf.Polyline(paths[k]);
+        }
+    }
+    const std::string d = ReadFileBytes(pdf_path);
+
+    size_t startxref = d.rfind("startxref\n");
+    long long xref = startxref == std::string::npos ? -1 : atoll(d.c_str() + startxref + 10);
+    bool xref_found = xref >= 0 && d.compare(xref, 5, "xref\n") == 0;
+
+    // xref entries: "0 n" then n lines of 20 bytes, entry k at the offset of object k
+    std::vector<long long> offsets;
+    bool offsets_resolve = xref_found;
+    if (xref_found)
+    {
+        int n = atoi(d.c_str() + xref + 7);
+        size_t entries = d.find('\n', xref + 5) + 1;
+        for (int k = 1; k < n; k++)
+        {
+            long long at = atoll(d.c_str() + entries + 20 * k);
+            std::string header = std::to_string(k) + " 0 obj\n";
+            offsets.push_back(at);
+            offsets_resolve = offsets_resolve && at < (long long)d.size() && d.compare(at, header.size(), header) == 0;
+        }
+    }
+
+    int streams = 0, strokes = 0;
+    bool lengths_match = offsets_resolve;
+    const std::string marker = "<< /Length ";
+    for (size_t at = d.find(marker); lengths_match && at != std::string::npos; at = d.find(marker, at + 1))
+    {
+        int length_object = atoi(d.c_str() + at + marker.size());
+        size_t data = d.find("stream\n", at) + 7;
+        long long length = length_object >= 1 && length_object <= (int)offsets.size()
+            ? atoll(d.c_str() + d.find('\n', offsets[length_object - 1]) + 1) : -1;
+        lengths_match = length >= 0 && d.compare(data + length, 10, "\nendstream") == 0;
+        if (!lengths_match)
+            break;
+
+        z_stream zs{};
+        inflateInit(&zs);
+        zs.next_in = (Bytef*)d.data() + data;
+        zs.avail_in = (uInt)length;
+        std::string content;
+        char buf[1 << 14];
+        int ret;
+        do
+        {
+            zs.next_out = (Bytef*)buf;
+            zs.avail_out = sizeof(buf);
+            ret = inflate(&zs, Z_NO_FLUSH);
+            content.append(buf, sizeof(buf) - zs.avail_out);
+        } while (ret == Z_OK);
+        inflateEnd(&zs);
+        lengths_match = ret == Z_STREAM_END;
+        streams++;
+        for (size_t i = content.find("S\n"); i != std::string::npos; i = content.find("S\n", i + 1))
+            strokes += i == 0 || content[i - 1] == '\n';
+    }
+
+    std::filesystem::path dir = file_path.substr(0, file_path.find_last_of('/'));
+    if (!std::filesystem::exists(dir))
+    {
+        std::filesystem::create_directories(dir);
+    }
+
+    std::ofstream outfile(file_path);
+    if (!outfile.is_open())
+    {
+        std::cerr << "Error: Could not open file " << file_path << " for writing." << std::endl;
+        return;
+    }
+
+    outfile << "Test Parameters:" << std::endl;
+    outfile << "r1: " << params.r1 << std::endl;
+    outfile << "r2: " << params.r2 << std::endl;
+    outfile << "h: " << params.h << std::endl;
+    outfile << "cir_res: " << params.cir_res << std::endl;
+    outfile << "cut_angle: " << params.cut_angle << std::endl;
+    outfile << "equidistant: " << (params.equidistant ? "true" : "false") << std::endl;
+    outfile << std::endl;
+
+    outfile << "Outputs:" << std::endl;
+    outfile << "polylines: " << paths.Count() << std::endl;
+    outfile << "objects: " << offsets.size() << std::endl;
+    outfile << "content streams: " << streams << std::endl;
+    CheckResult(outfile, file_path, "startxref points at the xref table", xref_found);
+    CheckResult(outfile, file_path, "xref offsets resolve", offsets_resolve);
+    CheckResult(outfile, file_path, "stream lengths match", lengths_match);
+    CheckResult(outfile, file_path, "one stroke per polyline and page", streams == 2 && strokes == 2 * paths.Count());
+
+    outfile.close();
+    std::cout << "Test results saved to " << file_path << std::endl;
+}
+
+void run_test_pdf_writer()
+{
+    constexpr TestParams params1 = {1.0, 0.8, 2.0, 100, M_PI / 4, 0.0, 0.0, 0.0, true};
+    const std::string file_path1 = "../results/test_PdfWriter_1.txt";
+    test_PdfWriter(file_path1, params1);
+
+    constexpr TestParams params2 = {3.0, 1.5, 5.0, 2000, M_PI / 4, 0.0, 0.0, 0.0, false};
+    const std::string file_path2 = "../results/test_PdfWriter_2.txt";
+    test_PdfWriter(file_path2, params2);
+}
+
+bool WriteTemplate(const TemplateJob& job, std::ostream& log); // the CLI's, below
+
+// SvgWriter and DxfWriter output read back: every polyline must come back as one path /
+// LWPOLYLINE whose points are the input points in millimeters (SVG with y down from the top of
+// the page) to within the written precision; the second page must go to PageFilePath(path, 2).
+// Then WriteTemplate's SVG and DXF, from the whole mesh and with -stream: the cut group / CUT
+// layer must hold only the template (offset from the page edges) and the page edge bars must be
+// marks when the template fits on one page.
+void test_SvgDxfWriter(const std::string& file_path, const TestParams& params)
+{
+    const PolylineSet paths = TestTemplatePolylines(params);
+    const PageDimensions page = GetPageDimensions(PageSize::A4);
+    const double mm_x = page.width_mm / page.width_pt, mm_y = page.height_mm / page.height_pt;
+    const double tolerance = 0.5e-3 + 1e-9; // precision 3
+    const std::filesystem::path tmp = std::filesystem::temp_directory_path();
+    const std::string svg_path = (tmp / "test_svg_writer.svg").string(), dxf_path = (tmp / "test_dxf_writer.dxf").string();
+    for (const std::string& path : {svg_path, dxf_path})
+    {
+        std::unique_ptr<PathWriter> writer = OpenPathWriter(path, page);
+        for (int k = 0; k < paths.Count(); k++)
+            writer->Polyline(paths[k]);
+        writer->NewPage();
+        writer->Polyline(paths[0]);
+        writer->Finish();
+    }
+
+    // SVG: the numbers of each <path d="M x y L x y ...">
+    PolylineSet svg;
+    const std::string svg_text = ReadFileBytes(svg_path);
+    for (size_t at = svg_text.find("<path d=\""); at != std::string::npos; at = svg_text.find("<path d=\"", at + 1))
+    {
+        std::stringstream d(svg_text.substr(at + 9, svg_text.find('"', at + 9) - at - 9));
+        std::string token;
+        std::vector<double> v;
+        while (d >> token)
+            if (token != "M" && token != "L")
+                v.push_back(atof(token.c_str()));
+        svg.NewPolyline();
+        for (size_t i = 0; i + 1 < v.size(); i += 2)
+            svg.Append(v[i], v[i + 1]);
+    }
+
+    // DXF: group code / value lines; 10 and 20 are the vertices of the current LWPOLYLINE
+    PolylineSet dxf;
+    bool cut_layer = true;
+    {
+        std::ifstream in(dxf_path);
+        std::string code, value;
+        double x = 0;
+        bool in_polyline = false;
+        while (std::getline(in, code) && std::getline(in, value))
+        {
+            if (code == "0")
+            {
+                in_polyline = value == "LWPOLYLINE";
+                if (in_polyline)
+                    dxf.NewPolyline();
+            }
+            else if (in_polyline && code == "8")
+                cut_layer = cut_layer && value == "CUT";
+            else if (in_polyline && code == "10")
+                x = atof(value.c_str());
+            else if (in_polyline && code == "20")
+                dxf.Append(x, atof(value.c_str()));
+        }
+    }
+
+    double svg_error = paths.Count() == svg.Count() ? 0 : INFINITY;
+    double dxf_error = paths.Count() == dxf.Count() ? 0 : INFINITY;
+    for (int k = 0; k < paths.Count(); k++)
+    {
+        if (svg.Count() == paths.Count() && svg.Points(k) != paths.Points(k))
+            svg_error = INFINITY;
+        if (dxf.Count() == paths.Count() && dxf.Points(k) != paths.Points(k))
+            dxf_error = INFINITY;
+        for (int i = 0; i < paths.Points(k) && std::isfinite(svg_error + dxf_error); i++)
+        {
+            double x = paths[k][2 * i] * mm_x, y = paths[k][2 * i + 1] * mm_y;
+            svg_error = std::max({svg_error, std::abs(svg[k][2 * i] - x), std::abs(svg[k][2 * i + 1] - (page.height_mm - y))});
+            dxf_error = std::max({dxf_error, std::abs(dxf[k][2 * i] - x), std::abs(dxf[k][2 * i + 1] - y)});
+        }
+    }
+    bool second_pages = ReadFileBytes(PageFilePath(svg_path, 2)).find("<path d=\"") != std::string::npos &&
+        ReadFileBytes(PageFilePath(dxf_path, 2)).find("LWPOLYLINE") != std::string::npos;
+
+    // a path on the page edge (mm, either y axis) is one of the bars
+    auto on_edge = [&](std::span<const double> p)
+    {
+        bool edge = true;
+        for (size_t i = 0; i + 1 < p.size(); i += 2)
+            edge = edge && (std::abs(p[i]) < 1e-9 || std::abs(p[i] - page.width_mm) < 1e-9 ||
+                            std::abs(p[i + 1]) < 1e-9 || std::abs(p[i + 1] - page.height_mm) < 1e-9);
+        return edge;
+    };
+    const bool saved_stream = stream;
+    bool tiled = false, cut_only_template = true, bars_are_marks = true;
+    int template_cut_paths = 0;
+    for (bool use_stream : {false, true})
+    {
+        stream = use_stream;
+        std::ostringstream log;
+        const TemplateJob svg_job{2 * M_PI * params.r1, 2 * M_PI * params.r2, params.h, params.cut_angle * 180 / M_PI,
+                                  svg_path};
+        TemplateJob dxf_job = svg_job;
+        dxf_job.outputfile = dxf_path;
+        WriteTemplate(svg_job, log);
+        WriteTemplate(dxf_job, log);
+        tiled = log.str().find("tiling it on") != std::string::npos;
+
+        // SVG: the points of each path and whether it is in the group "marks"
+        int cut_paths = 0, edge_marks = 0;
+        const std::string text = ReadFileBytes(svg_path);
+        for (size_t at = text.find("<path d=\""); at != std::string::npos; at = text.find("<path d=\"", at + 1))
+        {
+            std::stringstream d(text.substr(at + 9, text.find('"', at + 9) - at - 9));
+            std::string token;
+            std::vector<double> v;
+            while (d >> token)
+                if (token != "M" && token != "L")
+                    v.push_back(atof(token.c_str()));
+            const bool mark = text.rfind("<g id=\"marks\"", at) != std::string::npos &&
+                text.rfind("<g id=\"marks\"", at) > text.rfind("<g id=\"cut\"", at);
+            if (mark)
+                edge_marks += on_edge(v);
+            else
+            {
+                cut_paths++;
+                cut_only_template = cut_only_template && !on_edge(v);
+            }
+        }
+        bars_are_marks = bars_are_marks && (tiled || edge_marks == 2);
+
+        // DXF: the same per LWPOLYLINE, by its layer
+        int dxf_cut_paths = 0, dxf_edge_marks = 0;
+        std::ifstream in(dxf_path);
+        std::string code, value, layer;
+        std::vector<double> v;
+        auto end_entity = [&]
+        {
+            if (layer == "MARKS")
+                dxf_edge_marks += on_edge(v);
+            else if (layer == "CUT")
+            {
+                dxf_cut_paths++;
+                cut_only_template = cut_only_template && !on_edge(v);
+            }
+            layer.clear();
+            v.clear();
+        };
+        bool in_polyline = false;
+        while (std::getline(in, code) && std::getline(in, value))
+        {
+            if (code == "0")
+            {
+                if (in_polyline)
+                    end_entity();
+                in_polyline = value == "LWPOLYLINE";
+            }
+            else if (in_polyline && code == "8")
+                layer = value;
+            else if (in_polyline && (code == "10" || code == "20"))
+                v.push_back(atof(value.c_str()));
+        }
+        bars_are_marks = bars_are_marks && (tiled || dxf_edge_marks == 2);
+        cut_only_template = cut_only_template && cut_paths > 0 && cut_paths == dxf_cut_paths;
+        template_cut_paths = cut_paths;
+    }
+    stream = saved_stream;
+
+    std::filesystem::path dir = file_path.substr(0, file_path.find_last_of('/'));
+    if (!std::filesystem::exists(dir))
+    {
+        std::filesystem::create_directories(dir);
+    }
+
+    std::ofstream outfile(file_path);
+    if (!outfile.is_open())
+    {
+        std::cerr << "Error: Could not open file " << file_path << " for writing." << std::endl;
+        return;
+    }
+
+    outfile << "Test Parameters:" << std::endl;
+    outfile << "r1: " << params.r1 << std::endl;
+    outfile << "r2: " << params.r2 << std::endl;
+    outfile << "h: " << params.h << std::endl;
+    outfile << "cir_res: " << params.cir_res << std::endl;
+    outfile << "cut_angle: " << params.cut_angle << std::endl;
+    outfile << "equidistant: " << (params.equidistant ? "true" : "false") << std::endl;
+    outfile << std::endl;
+
+    outfile << "Outputs:" << std::endl;
+    outfile << "polylines: " << paths.Count() << ", svg paths: " << svg.Count() << ", dxf polylines: " << dxf.Count()
+        << std::endl;
+    outfile << "svg max error (mm): " << svg_error << std::endl;
+    outfile << "dxf max error (mm): " << dxf_error << std::endl;
+    CheckResult(outfile, file_path, "svg coordinates in mm within the precision", svg_error <= tolerance);
+    CheckResult(outfile, file_path, "dxf coordinates in mm within the precision", dxf_error <= tolerance);
+    CheckResult(outfile, file_path, "dxf polylines on layer CUT", cut_layer);
+    CheckResult(outfile, file_path, "second page in its own file", second_pages);
+    outfile << "WriteTemplate: " << template_cut_paths << " cut paths" << (tiled ? ", tiled" : ", one page")
+        << std::endl;
+    CheckResult(outfile, file_path, "WriteTemplate cut group / CUT layer holds only the template", cut_only_template);
+    CheckResult(outfile, file_path, "WriteTemplate page edge bars are marks", bars_are_marks);
+
+    outfile.close();
+    std::cout << "Test results saved to " << file_path << std::endl;
+}
+
+void run_test_svg_dxf_writer()
+{
+    constexpr TestParams params1 = {1.0, 0.8, 2.0, 100, M_PI / 4, 0.0, 0.0, 0.0, true};
+    const std::string file_path1 = "../results/test_SvgDxfWriter_1.txt";
+    test_SvgDxfWriter(file_path1, params1);
+
+    constexpr TestParams params2 = {3.0, 1.5, 5.0, 2000, M_PI / 4, 0.0, 0.0, 0.0, false};
+    const std::string file_path2 = "../results/test_SvgDxfWriter_2.txt";
+    test_SvgDxfWriter(file_path2, params2);
+}
+
+// Cut lines of a test template split into pieces of at most n points (neighbouring pieces
+// share their end point), in a scrambled order with every other piece reversed
+PolylineSet ScrambledPieces(const PolylineSet& paths, int n)
+{
+    std::vector<std::vector<double>> pieces;
+    for (int k = 0; k < paths.Count(); k++)
+    {
+        std::span<const double> p = paths[k];
+        for (int i = 0; i + 1 < paths.Points(k); i += n - 1)
+        {
+            int j = std::min(paths.Points(k), i + n);
+            pieces.emplace_back(p.begin() + 2 * i, p.begin() + 2 * j);
+        }
+    }
+    const int m = (int)pieces.size();
+    PolylineSet out;
+    for (int i = 0; i < m; i++)
+    {
+        std::vector<double>& piece = pieces[(long long)i * 7919 % m];
+        if (i % 2)
+            for (size_t a = 0, b = piece.size() - 2; a < b; a += 2, b -= 2)
+                std::swap(piece[a], piece[b]), std::swap(piece[a + 1], piece[b + 1]);
+        out.Add(piece);
+    }
+    return out;
+}
+
+// OptimizePathOrder on a scrambled template: every polyline must come out once, forwards or
+// reversed and otherwise unchanged, and the travel it reports must match TravelDistance and not
+// exceed the travel before
+void test_OptimizePathOrder(const std::string& file_path, const TestParams& params)
+{
+    const PolylineSet before = ScrambledPieces(TestTemplatePolylines(params), 12);
+    PolylineSet after = before;
+    TravelStats travel = OptimizePathOrder(after);
+
+    // match each output polyline to an unused input one with the same points in either direction
+    std::map<std::pair<double, double>, std::vector<int>> by_endpoint;
+    for (int k = 0; k < before.Count(); k++)
+        by_endpoint[{before[k][0], before[k][1]}].push_back(k);
+    std::vector<bool> used(before.Count(), false);
+    bool same_polylines = after.Count() == before.Count() && after.xy.size() == before.xy.size();
+    int reversed = 0;
+    for (int k = 0; same_polylines && k < after.Count(); k++)
+    {
+        std::span<const double> q = after[k];
+        const size_t n = q.size();
+        bool found = false;
+        for (bool rev : {false, true})
+        {
+            auto it = by_endpoint.find(rev ? std::make_pair(q[n - 2], q[n - 1]) : std::make_pair(q[0], q[1]));
+            if (it == by_endpoint.end())
+                continue;
+            for (int j : it->second)
+            {
+                std::span<const double> p = before[j];
+                if (used[j] || p.size() != n)
+                    continue;
+                bool equal = true;
+                for (size_t i = 0; equal && i < n; i += 2)
+                    equal = rev ? p[i] == q[n - 2 - i] && p[i + 1] == q[n - 1 - i] : p[i] == q[i] && p[i + 1] == q[i + 1];
+                if (equal)
+                {
+                    used[j] = found = true;
+                    reversed += rev;
+                    break;
+                }
+            }
+            if (found)
+                break;
+        }
+        same_polylines = found;
+    }
+
+    std::filesystem::path dir = file_path.substr(0, file_path.find_last_of('/'));
+    if (!std::filesystem::exists(dir))
+    {
+        std::filesystem::create_directories(dir);
+    }
+
+    std::ofstream outfile(file_path);
+    if (!outfile.is_open())
+    {
+        std::cerr << "Error: Could not open file " << file_path << " for writing." << std::endl;
+        return;
+    }
+
+    outfile << "Test Parameters:" << std::endl;
+    outfile << "r1: " << params.r1 << std::endl;
+    outfile << "r2: " << params.r2 << std::endl;
+    outfile << "h: " << params.h << std::endl;
+    outfile << "cir_res: " << params.cir_res << std::endl;
+    outfile << "cut_angle: " << params.cut_angle << std::endl;
+    outfile << "equidistant: " << (params.equidistant ? "true" : "false") << std::endl;
+    outfile << std::endl;
+
+    outfile << "Outputs:" << std::endl;
+    outfile << "polylines: " << before.Count() << std::endl;
+    outfile << "travel before: " << travel.before << std::endl;
+    outfile << "travel after: " << travel.after << std::endl;
+    outfile << "reversed polylines: " << reversed << std::endl;
+    CheckResult(outfile, file_path, "same polylines, each once", same_polylines);
+    CheckResult(outfile, file_path, "reported travel matches TravelDistance",
+                std::abs(travel.before - TravelDistance(before)) <= 1e-9 * travel.before &&
+                std::abs(travel.after - TravelDistance(after)) <= 1e-9 * std::max(1.0, travel.after));
+    CheckResult(outfile, file_path, "travel not increased", travel.after <= travel.before);
+
+    outfile.close();
+    std::cout << "Test results saved to " << file_path << std::endl;
+}
+
+void run_test_path_order()
+{
+    constexpr TestParams params1 = {1.0, 0.8, 2.0, 100, M_PI / 4, 0.0, 0.0, 0.0, true};
+    const std::string file_path1 = "../results/test_OptimizePathOrder_1.txt";
+    test_OptimizePathOrder(file_path1, params1);
+
+    constexpr TestParams params2 = {3.0, 1.5, 5.0, 2000, M_PI / 4, 0.0, 0.0, 0.0, false};
+    const std::string file_path2 = "../results/test_OptimizePathOrder_2.txt";
+    test_OptimizePathOrder(file_path2, params2);
+}
+
+// ClipToTiles on a template scaled up to span several A4 pages. Pieces must stay inside their
+// tile's window, a segment inside a window must reach that tile whole (its two points
+// consecutive in one polyline, not split), and every point of every segment must be on a piece
+// of some tile. The registration marks of neighbouring tiles must coincide on the layout, and
+// SVG / DXF must keep them out of the cut lines.
+void test_ClipToTiles(const std::string& file_path, const TestParams& params, double scale)
+{
+    PolylineSet paths = TestTemplatePolylines(params);
+    double layout_w = 0, layout_h = 0;
+    for (size_t i = 0; i < paths.xy.size(); i += 2)
+    {
+        paths.xy[i] *= scale;
+        paths.xy[i + 1] *= scale;
+        layout_w = std::max(layout_w, paths.xy[i]);
+        layout_h = std::max(layout_h, paths.xy[i + 1]);
+    }
+    const PageDimensions page = GetPageDimensions(PageSize::A4);
+    const TileGrid grid = PlanTiles(layout_w, layout_h, page);
+    std::vector<PolylineSet> tiles;
+    ClipToTiles(paths, grid, tiles);
+    const double eps = 1e-9 * std::max(layout_w, layout_h);
+
+    // pieces mapped back to layout coordinates, and each tile's consecutive point pairs
+    std::vector<std::array<double, 4>> pieces;
+    std::vector<std::set<std::array<double, 4>>> tile_segments(tiles.size());
+    bool inside_windows = true;
+    for (int r = 0; r < grid.rows; r++)
+    {
+        for (int c = 0; c < grid.cols; c++)
+        {
+            const int t = r * grid.cols + c;
+            const double ox = c * grid.step_x - grid.margin, oy = r * grid.step_y - grid.margin;
+            for (size_t i = 0; i < tiles[t].xy.size(); i += 2)
+                inside_windows = inside_windows && tiles[t].xy[i] >= grid.margin - eps &&
+                    tiles[t].xy[i] <= grid.margin + grid.window_w + eps && tiles[t].xy[i + 1] >= grid.margin - eps &&
+                    tiles[t].xy[i + 1] <= grid.margin + grid.window_h + eps;
+            for (int k = 0; k < tiles[t].Count(); k++)
+            {
+                std::span<const double> q = tiles[t][k];
+                for (size_t i = 0; i + 3 < q.size(); i += 2)
+                {
+                    pieces.push_back({q[i] + ox, q[i + 1] + oy, q[i + 2] + ox, q[i + 3] + oy});
+                    tile_segments[t].insert({q[i], q[i + 1], q[i + 2], q[i + 3]});
+                }
+            }
+        }
+    }
+
+    int segments = 0, whole_expected = 0, whole_found = 0, uncovered = 0;
+    for (int k = 0; k < paths.Count(); k++)
+    {
+        std::span<const double> p = paths[k];
+        for (size_t i = 0; i + 3 < p.size(); i += 2, segments++)
+        {
+            const double px = p[i], py = p[i + 1], qx = p[i + 2], qy = p[i + 3];
+            for (int r = 0; r < grid.rows; r++)
+            {
+                for (int c = 0; c < grid.cols; c++)
+                {
+                    const double wx = c * grid.step_x, wy = r * grid.step_y;
+                    if (std::min(px, qx) < wx || std::max(px, qx) > wx + grid.window_w || std::min(py, qy) < wy ||
+                        std::max(py, qy) > wy + grid.window_h)
+                        continue;
+                    const double ox = grid.margin - wx, oy = grid.margin - wy;
+                    whole_expected++;
+                    whole_found += tile_segments[r * grid.cols + c].count({px + ox, py + oy, qx + ox, qy + oy});
+                }
+            }
+            // a few points along the segment, each on some piece
+            for (int j = 0; j <= 4; j++)
+            {
+                const double x = px + j * (qx - px) / 4, y = py + j * (qy - py) / 4;
+                bool on_piece = false;
+                for (size_t n = 0; !on_piece && n < pieces.size(); n++)
+                {
+                    const std::array<double, 4>& s = pieces[n];
+                    const double dx = s[2] - s[0], dy = s[3] - s[1], len2 = dx * dx + dy * dy;
+                    const double t = len2 > 0 ? std::clamp(((x - s[0]) * dx + (y - s[1]) * dy) / len2, 0.0, 1.0) : 0;
+                    on_piece = std::hypot(s[0] + t * dx - x, s[1] + t * dy - y) <= 1e3 * eps;
+                }
+                uncovered += !on_piece;
+            }
+        }
+    }
+
+    // the marks of tile (c, r) in layout coordinates must be marks of its right and upper neighbours too
+    auto layout_marks = [&](int c, int r)
+    {
+        PolylineSet marks;
+        AddRegistrationMarks(grid, c, r, marks);
+        std::set<std::pair<long long, long long>> centers;
+        for (int k = 0; k < marks.Count(); k += 2)
+        {
+            // the horizontal arm's midpoint, rounded to 1e-6 pt
+            const double x = 0.5 * (marks[k][0] + marks[k][2]) + c * grid.step_x - grid.margin;
+            const double y = marks[k][1] + r * grid.step_y - grid.margin;
+            centers.insert({std::llround(x * 1e6), std::llround(y * 1e6)});
+        }
+        return centers;
+    };
+    int shared_marks = 0, neighbours = 0;
+    for (int r = 0; r < grid.rows; r++)
+    {
+        for (int c = 0; c < grid.cols; c++)
+        {
+            auto here = layout_marks(c, r);
+            for (auto [nc, nr] : {std::make_pair(c + 1, r), std::make_pair(c, r + 1)})
+            {
+                if (nc >= grid.cols || nr >= grid.rows)
+                    continue;
+                auto there = layout_marks(nc, nr);
+                neighbours++;
+                int common = 0;
+                for (auto& m : here)
+                    common += (int)there.count(m);
+                shared_marks += common == 2;
+            }
+        }
+    }
+
+    // one tile written with its marks: SVG group "marks" and DXF layer MARKS hold exactly the marks
+    PolylineSet marks;
+    AddRegistrationMarks(grid, 0, 0, marks);
+    const std::filesystem::path tmp = std::filesystem::temp_directory_path();
+    const std::string svg_path = (tmp / "test_tiles.svg").string(), dxf_path = (tmp / "test_tiles.dxf").string();
+    for (const std::string& path : {svg_path, dxf_path})
+    {
+        std::unique_ptr<PathWriter> writer = OpenPathWriter(path, page);
+        for (int k = 0; k < tiles[0].Count(); k++)
+            writer->Polyline(tiles[0][k]);
+        for (int k = 0; k < marks.Count(); k++)
+            writer->Mark(marks[k]);
+    }
+    const std::string svg = ReadFileBytes(svg_path), dxf = ReadFileBytes(dxf_path);
+    auto count = [](const std::string& text, const std::string& what, size_t from = 0, size_t to = std::string::npos)
+    {
+        int n = 0;
+        for (size_t at = text.find(what, from); at != std::string::npos && at < to; at = text.find(what, at + 1))
+            n++;
+        return n;
+    };
+    const size_t marks_group = svg.find("<g id=\"marks\"");
+    const bool svg_marks = marks_group != std::string::npos &&
+        count(svg, "<path", marks_group, svg.find("</g>", marks_group)) == marks.Count() &&
+        count(svg, "<path", 0, marks_group) == tiles[0].Count();
+    const bool dxf_marks = count(dxf, "LWPOLYLINE\n8\nMARKS\n") == marks.Count() &&
+        count(dxf, "LWPOLYLINE\n8\nCUT\n") == tiles[0].Count();
+
+    std::filesystem::path dir = file_path.substr(0, file_path.find_last_of('/'));
+    if (!std::filesystem::exists(dir))
+    {
+        std::filesystem::create_directories(dir);
+    }
+
+    std::ofstream outfile(file_path);
+    if (!outfile.is_open())
+    {
+        std::cerr << "Error: Could not open file " << file_path << " for writing." << std::endl;
+        return;
+    }
+
+    outfile << "Test Parameters:" << std::endl;
+    outfile << "r1: " << params.r1 << std::endl;
+    outfile << "r2: " << params.r2 << std::endl;
+    outfile << "h: " << params.h << std::endl;
+    outfile << "cir_res: " << params.cir_res << std::endl;
+    outfile << "cut_angle: " << params.cut_angle << std::endl;
+    outfile << "equidistant: " << (params.equidistant ? "true" : "false") << std::endl;
+    outfile << "scale: " << scale << std::endl;
+    outfile << std::endl;
+
+    outfile << "Outputs:" << std::endl;
+    outfile << "layout: " << layout_w << "x" << layout_h << " pt on " << grid.cols << "x" << grid.rows << " pages"
+        << std::endl;
+    outfile << "segments: " << segments << ", pieces: " << pieces.size() << std::endl;
+    outfile << "segments inside a window: " << whole_expected << ", found whole: " << whole_found << std::endl;
+    CheckResult(outfile, file_path, "pieces inside their windows", inside_windows);
+    CheckResult(outfile, file_path, "segments inside a window kept whole", whole_found == whole_expected);
+    CheckResult(outfile, file_path, "every segment covered by pieces", uncovered == 0);
+    CheckResult(outfile, file_path, "neighbouring tiles share two marks", shared_marks == neighbours);
+    CheckResult(outfile, file_path, "svg marks in their own group", svg_marks);
+    CheckResult(outfile, file_path, "dxf marks on layer MARKS", dxf_marks);
+
+    outfile.close();
+    std::cout << "Test results saved to " << file_path << std::endl;
+}
+
+void run_test_tiling()
+{
+    constexpr TestParams params1 = {1.0, 0.8, 2.0, 100, M_PI / 4, 0.0, 0.0, 0.0, true};
+    const std::string file_path1 = "../results/test_ClipToTiles_1.txt";
+    test_ClipToTiles(file_path1, params1, 4);
+
+    constexpr TestParams params2 = {3.0, 1.5, 5.0, 300, M_PI / 4, 0.0, 0.0, 0.0, false};
+    const std::string file_path2 = "../results/test_ClipToTiles_2.txt";
+    test_ClipToTiles(file_path2, params2, 3);
+}
+
+// Shortest distance between segments ab and cd (0 if they cross)
+double SegmentDistance(const double* a, const double* b, const double* c, const double* d)
+{
+    auto cross = [](const double* o, const double* p, const double* q)
+    {
+        return (p[0] - o[0]) * (q[1] - o[1]) - (p[1] - o[1]) * (q[0] - o[0]);
+    };
+    if (cross(a, b, c) * cross(a, b, d) < 0 && cross(c, d, a) * cross(c, d, b) < 0)
+        return 0;
+    auto point = [](const double* p, const double* s0, const double* s1)
+    {
+        const double dx = s1[0] - s0[0], dy = s1[1] - s0[1], len2 = dx * dx + dy * dy;
+        const double t = len2 > 0 ? std::clamp(((p[0] - s0[0]) * dx + (p[1] - s0[1]) * dy) / len2, 0.0, 1.0) : 0;
+        return std::hypot(s0[0] + t * dx - p[0], s0[1] + t * dy - p[1]);
+    };
+    return std::min({point(a, c, d), point(b, c, d), point(c, a, b), point(d, a, b)});
+}
+
+// NestOnSheets on copies of two templates (params' and one half as high): every placed item
+// must lie within the sheet margins, and items on the same sheet must neither cross nor come
+// closer than the gap (nor sit inside one another's bounding box). SameTemplate must group
+// parameters that only differ by the cm <-> radius round trip.
+void test_NestOnSheets(const std::string& file_path, const TestParams& params, int copies)
+{
+    TestParams half = params;
+    half.h *= 0.5;
+    const PolylineSet shapes[2] = {TestTemplatePolylines(params), TestTemplatePolylines(half)};
+    std::vector<NestItem> items(copies);
+    for (int i = 0; i < copies; i++)
+    {
+        items[i].paths = shapes[i % 2];
+        items[i].shape = i % 2;
+    }
+    const PageDimensions page = GetPageDimensions(PageSize::A4);
+    const double margin = 18, gap = 6;
+    NestResult nest = NestOnSheets(items, page.width_pt, page.height_pt, margin, gap);
+
+    std::vector<PolylineSet> placed(copies);
+    std::vector<std::array<double, 4>> box(copies); // min x, min y, max x, max y
+    int unplaced = 0;
+    bool inside_margins = true;
+    for (int i = 0; i < copies; i++)
+    {
+        if (nest.placements[i].sheet < 0)
+        {
+            unplaced++;
+            continue;
+        }
+        PlaceNestItem(items[i].paths, nest.placements[i], placed[i]);
+        box[i] = {INFINITY, INFINITY, -INFINITY, -INFINITY};
+        for (size_t k = 0; k < placed[i].xy.size(); k += 2)
+        {
+            box[i][0] = std::min(box[i][0], placed[i].xy[k]);
+            box[i][1] = std::min(box[i][1], placed[i].xy[k + 1]);
+            box[i][2] = std::max(box[i][2], placed[i].xy[k]);
+            box[i][3] = std::max(box[i][3], placed[i].xy[k + 1]);
+        }
+        inside_margins = inside_margins && box[i][0] >= margin - 1e-6 && box[i][1] >= margin - 1e-6 &&
+            box[i][2] <= page.width_pt - margin + 1e-6 && box[i][3] <= page.height_pt - margin + 1e-6;
+    }
+
+    double min_distance = INFINITY;
+    bool contained = false;
+    for (int i = 0; i < copies; i++)
+    {
+        for (int j = i + 1; j < copies; j++)
+        {
+            if (nest.placements[i].sheet < 0 || nest.placements[i].sheet != nest.placements[j].sheet)
+                continue;
+            contained = contained || (box[i][0] <= box[j][0] && box[i][1] <= box[j][1] && box[i][2] >= box[j][2] &&
+                box[i][3] >= box[j][3]) || (box[j][0] <= box[i][0] && box[j][1] <= box[i][1] &&
+                box[j][2] >= box[i][2] && box[j][3] >= box[i][3]);
+            // bounding boxes apart by the gap already bound the distance
+            if (box[i][0] > box[j][2] + gap || box[j][0] > box[i][2] + gap || box[i][1] > box[j][3] + gap ||
+                box[j][1] > box[i][3] + gap)
+                continue;
+            for (int a = 0; a < placed[i].Count(); a++)
+            {
+                std::span<const double> p = placed[i][a];
+                for (size_t u = 0; u + 3 < p.size(); u += 2)
+                {
+                    for (int b = 0; b < placed[j].Count(); b++)
+                    {
+                        std::span<const double> q = placed[j][b];
+                        for (size_t v = 0; v + 3 < q.size(); v += 2)
+                            min_distance = std::min(min_distance, SegmentDistance(&p[u], &p[u + 2], &q[v], &q[v + 2]));
+                    }
+                }
+            }
+        }
+    }
+
+    // 33.3 degrees does not survive the degrees -> radians -> degrees round trip bit for bit
+    const std::array<double, 4> input = {2 * M_PI * params.r1, 2 * M_PI * params.r2, params.h, 33.3};
+    const std::array<double, 4> round_trip = {2 * M_PI * (input[0] / (2 * M_PI)), 2 * M_PI * (input[1] / (2 * M_PI)),
+                                              input[2], input[3] / 180 * M_PI * 180 / M_PI};
+    const std::array<double, 4> other = {input[0], input[1], input[2], 33.301};
+
+    std::filesystem::path dir = file_path.substr(0, file_path.find_last_of('/'));
+    if (!std::filesystem::exists(dir))
+    {
+        std::filesystem::create_directories(dir);
+    }
+
+    std::ofstream outfile(file_path);
+    if (!outfile.is_open())
+    {
+        std::cerr << "Error: Could not open file " << file_path << " for writing." << std::endl;
+        return;
+    }
+
+    outfile << "Test Parameters:" << std::endl;
+    outfile << "r1: " << params.r1 << std::endl;
+    outfile << "r2: " << params.r2 << std::endl;
+    outfile << "h: " << params.h << std::endl;
+    outfile << "cir_res: " << params.cir_res << std::endl;
+    outfile << "cut_angle: " << params.cut_angle << std::endl;
+    outfile << "equidistant: " << (params.equidistant ? "true" : "false") << std::endl;
+    outfile << "copies: " << copies << std::endl;
+    outfile << std::endl;
+
+    outfile << "Outputs:" << std::endl;
+    outfile << "sheets: " << nest.sheets << ", hull coverage: " << nest.total_hull_coverage << std::endl;
+    outfile << "min distance between items on a sheet (pt): " << min_distance << std::endl;
+    CheckResult(outfile, file_path, "every item placed", unplaced == 0);
+    CheckResult(outfile, file_path, "items inside the sheet margins", inside_margins);
+    CheckResult(outfile, file_path, "items at least the gap apart", min_distance >= gap);
+    CheckResult(outfile, file_path, "no item inside another's box", !contained);
+    outfile << "round trip exact: " << (input == round_trip ? "true" : "false") << std::endl;
+    CheckResult(outfile, file_path, "round-tripped parameters grouped", SameTemplate(input, round_trip));
+    CheckResult(outfile, file_path, "different parameters not grouped", !SameTemplate(input, other));
+
+    outfile.close();
+    std::cout << "Test results saved to " << file_path << std::endl;
+}
+
+void run_test_nesting()
+{
+    constexpr TestParams params1 = {1.0, 0.8, 2.0, 100, M_PI / 4, 0.0, 0.0, 0.0, true};
+    const std::string file_path1 = "../results/test_NestOnSheets_1.txt";
+    test_NestOnSheets(file_path1, params1, 12);
+
+    constexpr TestParams params2 = {1.5, 1.0, 3.0, 200, M_PI / 4, 0.0, 0.0, 0.0, false};
+    const std::string file_path2 = "../results/test_NestOnSheets_2.txt";
+    test_NestOnSheets(file_path2, params2, 20);
+}
+
+// Largest distance from a vertex of xy to the segment of the simplified line that spans it
+// (the simplified points are a subsequence of xy); INFINITY if they are not
+double SimplifyError(std::span<const double> xy, std::span<const double> simplified)
+{
+    double max_error = 0;
+    size_t j = 0; // simplified point at or before vertex i
+    for (size_t i = 0; i < xy.size(); i += 2)
+    {
+        if (j + 2 < simplified.size() && xy[i] == simplified[j + 2] && xy[i + 1] == simplified[j + 3])
+            j += 2;
+        if (xy[i] == simplified[j] && xy[i + 1] == simplified[j + 1])
+            continue;
+        if (j + 2 >= simplified.size())
+            return INFINITY;
+        const double a[2] = {simplified[j], simplified[j + 1]}, b[2] = {simplified[j + 2], simplified[j + 3]};
+        max_error = std::max(max_error, SegmentDistance(&xy[i], &xy[i], a, b));
+    }
+    return j + 2 == simplified.size() ? max_error : INFINITY;
+}
+
+// SimplifyPolyline on a template's cut lines (in points): every dropped vertex within the
+// tolerance of the simplified line, endpoints kept, and the distances it evaluates within
+// 2 n log2 n. The worst case is quadratic: a zigzag of shrinking amplitude makes every span's
+// farthest vertex the one next to its start, which costs (n - 1)(n - 2) / 2 distances. The
+// streamed layout simplifies PolylineJoiner pieces of at most 4096 points one by one, so on
+// longer chains it keeps more points than the whole-mesh output; both stay within tolerance.
+void test_SimplifyPolyline(const std::string& file_path, const TestParams& params, double tolerance)
+{
+    const PolylineSet paths = TestTemplatePolylines(params);
+    double max_error = 0;
+    bool endpoints_kept = true;
+    long long points = 0, kept = 0, distances = 0, bound = 0;
+    std::vector<double> out;
+    for (int k = 0; k < paths.Count(); k++)
+    {
+        std::span<const double> p = paths[k];
+        const long long n = paths.Points(k);
+        distances = std::max(distances, SimplifyPolyline(p, tolerance, out));
+        bound = std::max(bound, (long long)(2 * n * std::log2((double)n)));
+        max_error = std::max(max_error, SimplifyError(p, out));
+        endpoints_kept = endpoints_kept && out.size() >= 4 && out[0] == p[0] && out[1] == p[1] &&
+            out[out.size() - 2] == p[p.size() - 2] && out.back() == p.back();
+        points += n;
+        kept += (long long)out.size() / 2;
+    }
+
+    // the same chains cut into joiner pieces
+    long long stream_kept = 0, pieces = 0;
+    double stream_error = 0;
+    {
+        PolylineJoiner joiner([&](std::span<const double> xy)
+        {
+            SimplifyPolyline(xy, tolerance, out);
+            stream_error = std::max(stream_error, SimplifyError(xy, out));
+            stream_kept += (long long)out.size() / 2;
+            pieces++;
+        });
+        for (int k = 0; k < paths.Count(); k++)
+            for (size_t i = 0; i + 3 < paths[k].size(); i += 2)
+                joiner.Segment(paths[k][i], paths[k][i + 1], paths[k][i + 2], paths[k][i + 3]);
+    }
+
+    // worst case: zigzag whose amplitude shrinks along the chain
+    const int zn = 2000;
+    std::vector<double> zigzag;
+    for (int i = 0; i < zn; i++)
+    {
+        zigzag.push_back(i);
+        zigzag.push_back((i % 2 ? 1 : -1) * (zn - i));
+    }
+    const long long zigzag_distances = SimplifyPolyline(zigzag, 0.1, out);
+    const double zigzag_error = SimplifyError(zigzag, out);
+
+    std::filesystem::path dir = file_path.substr(0, file_path.find_last_of('/'));
+    if (!std::filesystem::exists(dir))
+    {
+        std::filesystem::create_directories(dir);
+    }
+
+    std::ofstream outfile(file_path);
+    if (!outfile.is_open())
+    {
+        std::cerr << "Error: Could not open file " << file_path << " for writing." << std::endl;
+        return;
+    }
+
+    outfile << "Test Parameters:" << std::endl;
+    outfile << "r1: " << params.r1 << std::endl;
+    outfile << "r2: " << params.r2 << std::endl;
+    outfile << "h: " << params.h << std::endl;
+    outfile << "cir_res: " << params.cir_res << std::endl;
+    outfile << "cut_angle: " << params.cut_angle << std::endl;
+    outfile << "equidistant: " << (params.equidistant ? "true" : "false") << std::endl;
+    outfile << "tolerance (pt): " << tolerance << std::endl;
+    outfile << std::endl;
+
+    outfile << "Outputs:" << std::endl;
+    outfile << "points: " << points << ", kept: " << kept << std::endl;
+    outfile << "max error: " << max_error << std::endl;
+    outfile << "distances, longest chain: " << distances << " (2 n log2 n: " << bound << ")" << std::endl;
+    outfile << "streamed in " << pieces << " joiner pieces: kept " << stream_kept << ", max error " << stream_error
+        << std::endl;
+    outfile << "zigzag of " << zn << " points: " << zigzag_distances << " distances, kept " << out.size() / 2
+        << std::endl;
+    CheckResult(outfile, file_path, "dropped vertices within tolerance", max_error <= tolerance);
+    CheckResult(outfile, file_path, "endpoints kept", endpoints_kept);
+    CheckResult(outfile, file_path, "distances within 2 n log2 n", distances <= bound);
+    CheckResult(outfile, file_path, "streamed pieces within tolerance", stream_error <= tolerance);
+    CheckResult(outfile, file_path, "streamed keeps the whole-mesh points or more", stream_kept >= kept);
+    CheckResult(outfile, file_path, "zigzag within tolerance", zigzag_error <= 0.1);
+    CheckResult(outfile, file_path, "zigzag costs (n - 1)(n - 2) / 2 distances",
+                zigzag_distances == (long long)(zn - 1) * (zn - 2) / 2);
+
+    outfile.close();
+    std::cout << "Test results saved to " << file_path << std::endl;
+}
+
+void run_test_simplify()
+{
+    constexpr TestParams params1 = {1.0, 0.8, 2.0, 100, M_PI / 4, 0.0, 0.0, 0.0, true};
+    const std::string file_path1 = "../results/test_SimplifyPolyline_1.txt";
+    test_SimplifyPolyline(file_path1, params1, 0.1 * 2.835);
+
+    // chains of more than 4096 points, so the streamed pieces differ from the whole chains
+    constexpr TestParams params2 = {3.0, 1.5, 5.0, 20000, M_PI / 4, 0.0, 0.0, 0.0, false};
+    const std::string file_path2 = "../results/test_SimplifyPolyline_2.txt";
+    test_SimplifyPolyline(file_path2, params2, 0.05 * 2.835);
+}
+
+// FitCubicBeziers on a template's cut lines and on an arc that meets a line at a right angle.
+// Every input point must be within the tolerance of the fitted chain (measured on the curves
+// flattened to 256 chords each, which adds well under 1e-3 of the tolerance here); at every
+// junction of two curves the tangents must line up (G1) unless the junction is an input vertex
+// turning by more than the corner angle, and the right angle must stay a corner.
+void test_FitCubicBeziers(const std::string& file_path, const TestParams& params, double tolerance)
+{
+    PolylineSet lines = TestTemplatePolylines(params);
+    // quarter arc of radius 100 pt in 40 steps, then 30 steps straight down from its end
+    lines.NewPolyline();
+    for (int i = 0; i <= 40; i++)
+        lines.Append(100 * cos(M_PI / 2 * i / 40), 100 * sin(M_PI / 2 * i / 40));
+    for (int i = 1; i <= 30; i++)
+        lines.Append(0 - 2 * i, 100);
+    const double corner_degrees = 45;
+
+    int curves = 0, junctions = 0, smooth_junctions = 0, corners_expected = 0, corners_kept = 0;
+    double max_error = 0, max_kink = 0;
+    std::vector<double> out;
+    for (int k = 0; k < lines.Count(); k++)
+    {
+        std::span<const double> p = lines[k];
+        const int n = lines.Points(k);
+        const int m = FitCubicBeziers(p, tolerance, out, corner_degrees);
+        curves += m;
+
+        // the curves as one dense polyline
+        std::vector<double> flat{out[0], out[1]};
+        for (int c = 0; c < m; c++)
+        {
+            const double* b = &out[6 * c];
+            for (int j = 1; j <= 256; j++)
+            {
+                double t = j / 256.0, u = 1 - t;
+                double w0 = u * u * u, w1 = 3 * u * u * t, w2 = 3 * u * t * t, w3 = t * t * t;
+                flat.push_back(w0 * b[0] + w1 * b[2] + w2 * b[4] + w3 * b[6]);
+                flat.push_back(w0 * b[1] + w1 * b[3] + w2 * b[5] + w3 * b[7]);
+            }
+        }
+        for (int i = 0; i < n; i++)
+        {
+            double d = INFINITY;
+            for (size_t j = 0; j + 3 < flat.size(); j += 2)
+                d = std::min(d, SegmentDistance(&p[2 * i], &p[2 * i], &flat[j], &flat[j + 2]));
+            max_error = std::max(max_error, d);
+        }
+
+        // input corners: vertices where the line turns by more than corner_degrees
+        std::set<std::pair<double, double>> corners;
+        for (int i = 1; i + 1 < n; i++)
+        {
+            const double ax = p[2 * i] - p[2 * i - 2], ay = p[2 * i + 1] - p[2 * i - 1];
+            const double bx = p[2 * i + 2] - p[2 * i], by = p[2 * i + 3] - p[2 * i + 1];
+            if ((ax * bx + ay * by) / (std::hypot(ax, ay) * std::hypot(bx, by)) < cos(corner_degrees * M_PI / 180))
+                corners.insert({p[2 * i], p[2 * i + 1]});
+        }
+        corners_expected += (int)corners.size();
+
+        for (int c = 1; c < m; c++)
+        {
+            const double* q = &out[6 * c]; // junction point
+            const double ix = q[0] - q[-2], iy = q[1] - q[-1], ox = q[2] - q[0], oy = q[3] - q[1];
+            const double sin_turn = (ix * oy - iy * ox) / (std::hypot(ix, iy) * std::hypot(ox, oy));
+            const double cos_turn = (ix * ox + iy * oy) / (std::hypot(ix, iy) * std::hypot(ox, oy));
+            junctions++;
+            if (corners.count({q[0], q[1]}))
+            {
+                corners_kept += cos_turn < cos(corner_degrees * M_PI / 180);
+                continue;
+            }
+            max_kink = std::max(max_kink, std::abs(sin_turn));
+            smooth_junctions += std::abs(sin_turn) <= 1e-9 && cos_turn > 0;
+        }
+    }
+
+    std::filesystem::path dir = file_path.substr(0, file_path.find_last_of('/'));
+    if (!std::filesystem::exists(dir))
+    {
+        std::filesystem::create_directories(dir);
+    }
+
+    std::ofstream outfile(file_path);
+    if (!outfile.is_open())
+    {
+        std::cerr << "Error: Could not open file " << file_path << " for writing." << std::endl;
+        return;
+    }
+
+    outfile << "Test Parameters:" << std::endl;
+    outfile << "r1: " << params.r1 << std::endl;
+    outfile << "r2: " << params.r2 << std::endl;
+    outfile << "h: " << params.h << std::endl;
+    outfile << "cir_res: " << params.cir_res << std::endl;
+    outfile << "cut_angle: " << params.cut_angle << std::endl;
+    outfile << "equidistant: " << (params.equidistant ? "true" : "false") << std::endl;
+    outfile << "tolerance (pt): " << tolerance << std::endl;
+    outfile << std::endl;
+
+    outfile << "Outputs:" << std::endl;
+    outfile << "points: " << lines.xy.size() / 2 << ", curves: " << curves << std::endl;
+    outfile << "max error: " << max_error << std::endl;
+    outfile << "junctions: " << junctions << ", smooth: " << smooth_junctions << ", corners: " << corners_kept
+        << " of " << corners_expected << std::endl;
+    outfile << "max |sin| of the turn at smooth junctions: " << max_kink << std::endl;
+    CheckResult(outfile, file_path, "points within tolerance", max_error <= tolerance * (1 + 1e-3));
+    CheckResult(outfile, file_path, "G1 at split points", smooth_junctions == junctions - corners_kept);
+    CheckResult(outfile, file_path, "corners kept", corners_expected > 0 && corners_kept == corners_expected);
+
+    outfile.close();
+    std::cout << "Test results saved to " << file_path << std::endl;
+}
+
+void run_test_bezier_fit()
+{
+    constexpr TestParams params1 = {1.0, 0.8, 2.0, 100, M_PI / 4, 0.0, 0.0, 0.0, true};
+    const std::string file_path1 = "../results/test_FitCubicBeziers_1.txt";
+    test_FitCubicBeziers(file_path1, params1, 0.1 * 2.835);
+
+    constexpr TestParams params2 = {3.0, 1.5, 5.0, 2000, M_PI / 4, 0.0, 0.0, 0.0, false};
+    const std::string file_path2 = "../results/test_FitCubicBeziers_2.txt";
+    test_FitCubicBeziers(file_path2, params2, 0.02 * 2.835);
+}
+
+// ReadBatch on a CSV file under a reordered header, a JSONL file and a CSV file without a header
+// whose first row has a bad number: good rows parse to their values, every malformed row is kept
+// with its own line number and error, and blank and # lines are skipped
+void test_ReadBatch(const std::string& file_path)
+{
+    std::istringstream csv(
+        "height, outputfile, circumference1, circumference2, cut_angle\n"
+        "10,a.pdf,30,20,45\n"
+        "\n"
+        "# comment\n"
+        "10,\"b, c.svg\",30,20,x45\n"
+        "10,d.pdf,30\n"
+        "-1,e.pdf,30,20,45\n"
+        "10,,30,20,45\n");
+    std::istringstream jsonl(
+        "{\"circumference1\": 30, \"circumference2\": 20, \"height\": 10, \"cut_angle\": 45, \"outputfile\": \"f.dxf\"}\n"
+        "{\"circumference1\": 30, \"circumference2\": 20, \"height\": 10, \"cut_angle\": 45, \"outputfile\": \"g.pdf\"\n"
+        "{\"circumference1\": \"30\", \"circumference2\": 20, \"height\": 10, \"cut_angle\": 45, \"outputfile\": \"h.pdf\"}\n"
+        "{\"circumference1\": 30, \"circumference2\": 20, \"height\": 10, \"outputfile\": \"i.pdf\"}\n");
+    std::istringstream headless(
+        "30x,20,10,45,j.pdf\n"
+        "30,20,10,45,k.pdf\n");
+    const std::vector<BatchItem> csv_items = ReadBatch(csv);
+    const std::vector<BatchItem> jsonl_items = ReadBatch(jsonl);
+    const std::vector<BatchItem> headless_items = ReadBatch(headless);
+
+    auto error_is = [](const std::vector<BatchItem>& items, size_t i, int line, const std::string& start)
+    {
+        return i < items.size() && items[i].line == line && items[i].error.rfind(start, 0) == 0 &&
+            (start.empty() ? items[i].error.empty() : true);
+    };
+    const TemplateJob& a = csv_items.size() > 0 ? csv_items[0].job : TemplateJob();
+    const bool csv_good = error_is(csv_items, 0, 2, "") && a.circumference1 == 30 && a.circumference2 == 20 &&
+        a.height == 10 && a.cut_angle == 45 && a.outputfile == "a.pdf";
+    const bool csv_errors = csv_items.size() == 5 && error_is(csv_items, 1, 5, "bad cut_angle: 'x45'") &&
+        csv_items[1].job.outputfile == "b, c.svg" && error_is(csv_items, 2, 6, "missing circumference2") &&
+        error_is(csv_items, 3, 7, "circumferences and height must be positive") &&
+        error_is(csv_items, 4, 8, "empty outputfile");
+    const bool jsonl_good = error_is(jsonl_items, 0, 1, "") && jsonl_items[0].job.outputfile == "f.dxf" &&
+        jsonl_items[0].job.cut_angle == 45;
+    const bool jsonl_errors = jsonl_items.size() == 4 && error_is(jsonl_items, 1, 2, "malformed JSON") &&
+        error_is(jsonl_items, 2, 3, "malformed JSON: circumference1 must be a number") &&
+        error_is(jsonl_items, 3, 4, "missing cut_angle");
+    const bool headless_rows = headless_items.size() == 2 && error_is(headless_items, 0, 1, "bad circumference1: '30x'") &&
+        error_is(headless_items, 1, 2, "") && headless_items[1].job.outputfile == "k.pdf";
+
+    std::filesystem::path dir = file_path.substr(0, file_path.find_last_of('/'));
+    if (!std::filesystem::exists(dir))
+    {
+        std::filesystem::create_directories(dir);
+    }
+
+    std::ofstream outfile(file_path);
+    if (!outfile.is_open())
+    {
+        std::cerr << "Error: Could not open file " << file_path << " for writing." << std::endl;
+        return;
+    }
+
+    outfile << "Outputs:" << std::endl;
+    for (const std::vector<BatchItem>* items : {&csv_items, &jsonl_items, &headless_items})
+        for (const BatchItem& item : *items)
+            outfile << "line " << item.line << ": " << item.job.outputfile << " "
+                << (item.error.empty() ? "ok" : item.error) << std::endl;
+    CheckResult(outfile, file_path, "CSV row under the header", csv_good);
+    CheckResult(outfile, file_path, "CSV malformed rows", csv_errors);
+    CheckResult(outfile, file_path, "JSONL object", jsonl_good);
+    CheckResult(outfile, file_path, "JSONL malformed rows", jsonl_errors);
+    CheckResult(outfile, file_path, "bad first row is data, not a header", headless_rows);
+
+    outfile.close();
+    std::cout << "Test results saved to " << file_path << std::endl;
+}
+
+void run_test_read_batch()
+{
+    test_ReadBatch("../results/test_ReadBatch_1.txt");
+}
+
+// The faces of a strip-ordered mesh reordered outwards from the middle face (m, m+1, m-1, m+2,
+// m-2, ...): every face still shares an edge with an earlier one, but in general not with the
+// face just before it, so UnwarpCylinder has to look its edge up in the adjacency
+Eigen::MatrixXi StripOrderShuffled(const Eigen::MatrixXi& F)
+{
+    const int n = (int)F.rows(), m = n / 2;
+    Eigen::MatrixXi out(n, 3);
+    int row = 0;
+    out.row(row++) = F.row(m);
+    for (int k = 1; row < n; k++)
+    {
+        if (m + k < n)
+            out.row(row++) = F.row(m + k);
+        if (m - k >= 0)
+            out.row(row++) = F.row(m - k);
+    }
+    return out;
+}
+
+// UnwarpCylinderParallel against UnwarpCylinder: on a strip-ordered mesh within 1e-9 of the strip
+// extent, as documented, and on the same faces out of strip order (StripOrderShuffled) the
+// fallback must give UnwarpCylinder's result exactly
+void test_UnwarpCylinderParallel(const std::string& file_path, const TestParams& params)
+{
+    Eigen::MatrixXd V, P, Vuv, Vpar, Vuv_shuffled, Vpar_shuffled;
+    Eigen::MatrixXi F;
+    std::vector<int> edges, corrs;
+    CreateCylinderWithCut(params.r1, params.r2, params.h, V, F, P, params.cir_res, params.cut_angle, params.equidistant,
+                          edges, corrs);
+    UnwarpCylinder(V, F, Vuv);
+    UnwarpCylinderParallel(V, F, Vpar);
+    const double extent = (Vuv.colwise().maxCoeff() - Vuv.colwise().minCoeff()).norm();
+    const double strip_diff = (Vpar - Vuv).cwiseAbs().maxCoeff();
+
+    Eigen::MatrixXi shuffled = StripOrderShuffled(F);
+    UnwarpCylinder(V, shuffled, Vuv_shuffled);
+    UnwarpCylinderParallel(V, shuffled, Vpar_shuffled);
+    const double fallback_diff = (Vpar_shuffled - Vuv_shuffled).cwiseAbs().maxCoeff();
+
+    std::filesystem::path dir = file_path.substr(0, file_path.find_last_of('/'));
+    if (!std::filesystem::exists(dir))
+    {
+        std::filesystem::create_directories(dir);
+    }
+
+    std::ofstream outfile(file_path);
+    if (!outfile.is_open())
+    {
+        std::cerr << "Error: Could not open file " << file_path << " for writing." << std::endl;
+        return;
+    }
+
+    outfile << "Test Parameters:" << std::endl;
+    outfile << "r1: " << params.r1 << std::endl;
+    outfile << "r2: " << params.r2 << std::endl;
+    outfile << "h: " << params.h << std::endl;
+    outfile << "cir_res: " << params.cir_res << std::endl;
+    outfile << "cut_angle: " << params.cut_angle << std::endl;
+    outfile << "equidistant: " << (params.equidistant ? "true" : "false") << std::endl;
+    outfile << std::endl;
+
+    outfile << "Outputs:" << std::endl;
+    outfile << "faces: " << F.rows() << ", extent: " << extent << std::endl;
+    outfile << "strip order max diff: " << strip_diff << std::endl;
+    outfile << "shuffled faces max diff: " << fallback_diff << std::endl;
+    CheckResult(outfile, file_path, "strip order within 1e-9 of the extent", strip_diff <= 1e-9 * extent);
+    CheckResult(outfile, file_path, "shuffled faces fall back to UnwarpCylinder", fallback_diff == 0);
+
+    outfile.close();
+    std::cout << "Test results saved to " << file_path << std::endl;
+}
+
+void run_test_unwrap_parallel()
+{
+    constexpr TestParams params1 = {1.0, 0.8, 2.0, 100, M_PI / 4, 0.0, 0.0, 0.0, true};
+    const std::string file_path1 = "../results/test_UnwarpCylinderParallel_1.txt";
+    test_UnwarpCylinderParallel(file_path1, params1);
+
+    constexpr TestParams params2 = {3.0, 1.5, 5.0, 20000, M_PI / 4, 0.0, 0.0, 0.0, false};
+    const std::string file_path2 = "../results/test_UnwarpCylinderParallel_2.txt";
+    test_UnwarpCylinderParallel(file_path2, params2);
+}
+
+// UnwarpCylinder on faces out of strip order (StripOrderShuffled), which takes the
+// EdgeFaceAdjacency lookup for every face that is not next to the one before it: the layout
+// must be the strip-order one up to a rigid motion, within 1e-9 of the strip extent. The first
+// face differs and is laid out with its third vertex on the +y side of its first edge, so the
+// motion may include a mirror image.
+void test_UnwarpCylinderShuffled(const std::string& file_path, const TestParams& params)
+{
+    Eigen::MatrixXd V, P, Vuv, Vuv_shuffled;
+    Eigen::MatrixXi F;
+    std::vector<int> edges, corrs;
+    CreateCylinderWithCut(params.r1, params.r2, params.h, V, F, P, params.cir_res, params.cut_angle, params.equidistant,
+                          edges, corrs);
+    UnwarpCylinder(V, F, Vuv);
+    Eigen::MatrixXi shuffled = StripOrderShuffled(F);
+    UnwarpCylinder(V, shuffled, Vuv_shuffled);
+
+    // faces whose edge is looked up: those not sharing two vertices with the face before
+    int lookups = 0;
+    for (int f = 1; f < shuffled.rows(); f++)
+    {
+        int shared = 0;
+        for (int c = 0; c < 3; c++)
+            for (int d = 0; d < 3; d++)
+                shared += shuffled(f, c) == shuffled(f - 1, d);
+        lookups += shared < 2;
+    }
+    const double extent = (Vuv.colwise().maxCoeff() - Vuv.colwise().minCoeff()).norm();
+    Eigen::MatrixXd mirrored = Vuv_shuffled;
+    mirrored.col(1) *= -1;
+    const double deviation = std::min(AlignedDeviation(Vuv, Vuv_shuffled, F), AlignedDeviation(Vuv, mirrored, F));
+
+    std::filesystem::path dir = file_path.substr(0, file_path.find_last_of('/'));
+    if (!std::filesystem::exists(dir))
+    {
+        std::filesystem::create_directories(dir);
+    }
+
+    std::ofstream outfile(file_path);
+    if (!outfile.is_open())
+    {
+        std::cerr << "Error: Could not open file " << file_path << " for writing." << std::endl;
+        return;
+    }
+
+    outfile << "Test Parameters:" << std::endl;
+    outfile << "r1: " << params.r1 << std::endl;
+    outfile << "r2: " << params.r2 << std::endl;
+    outfile << "h: " << params.h << std::endl;
+    outfile << "cir_res: " << params.cir_res << std::endl;
+    outfile << "cut_angle: " << params.cut_angle << std::endl;
+    outfile << "equidistant: " << (params.equidistant ? "true" : "false") << std::endl;
+    outfile << std::endl;
+
+    outfile << "Outputs:" << std::endl;
+    outfile << "faces: " << F.rows() << ", adjacency lookups: " << lookups << ", extent: " << extent << std::endl;
+    outfile << "max deviation from strip order: " << deviation << std::endl;
+    CheckResult(outfile, file_path, "faces out of strip order", lookups > F.rows() / 3);
+    CheckResult(outfile, file_path, "same layout as strip order within 1e-9 of the extent", deviation <= 1e-9 * extent);
+
+    outfile.close();
+    std::cout << "Test results saved to " << file_path << std::endl;
+}
+
+void run_test_unwrap_shuffled()
+{
+    constexpr TestParams params1 = {1.0, 0.8, 2.0, 100, M_PI / 4, 0.0, 0.0, 0.0, true};
+    const std::string file_path1 = "../results/test_UnwarpCylinderShuffled_1.txt";
+    test_UnwarpCylinderShuffled(file_path1, params1);
+
+    constexpr TestParams params2 = {3.0, 1.5, 5.0, 20000, M_PI / 4, 0.0, 0.0, 0.0, false};
+    const std::string file_path2 = "../results/test_UnwarpCylinderShuffled_2.txt";
+    test_UnwarpCylinderShuffled(file_path2, params2);
+}
+
+// Largest relative change of a face edge length between V and Vuv (0 for an exact unfolding)
+double MaxEdgeLengthError(const Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>& V,
+                          const Eigen::Matrix<int, Eigen::Dynamic, Eigen::Dynamic>& F,
+                          const Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>& Vuv)
+{
+    double max_err = 0;
+    for (int f = 0; f < F.rows(); f++)
+    {
+        for (int c = 0; c < 3; c++)
+        {
+            int a = F(f, c), b = F(f, (c + 1) % 3);
+            double len = (V.row(a) - V.row(b)).norm();
+            double len_uv = (Vuv.block<1, 2>(a, 0) - Vuv.block<1, 2>(b, 0)).norm();
+            if (len > 0)
+                max_err = std::max(max_err, std::abs(len_uv - len) / len);
+        }
+    }
+    return max_err;
+}
+
+// UnwarpCylinder with UnwrapPlacement::Trig and ::Projection: the two layouts must agree within
+// 1e-9 of the strip extent and both must keep every face edge length to 1e-9 relative
+void test_UnwrapPlacement(const std::string& file_path, const TestParams& params)
+{
+    Eigen::MatrixXd V, P, Vtrig, Vproj;
+    Eigen::MatrixXi F;
+    std::vector<int> edges, corrs;
+    CreateCylinderWithCut(params.r1, params.r2, params.h, V, F, P, params.cir_res, params.cut_angle, params.equidistant,
+                          edges, corrs);
+    UnwarpCylinder(V, F, Vtrig, UnwrapPlacement::Trig);
+    UnwarpCylinder(V, F, Vproj, UnwrapPlacement::Projection);
+    const double extent = (Vproj.colwise().maxCoeff() - Vproj.colwise().minCoeff()).norm();
+    const double diff = (Vtrig - Vproj).cwiseAbs().maxCoeff();
+    const double trig_error = MaxEdgeLengthError(V, F, Vtrig), proj_error = MaxEdgeLengthError(V, F, Vproj);
+
+    std::filesystem::path dir = file_path.substr(0, file_path.find_last_of('/'));
+    if (!std::filesystem::exists(dir))
+    {
+        std::filesystem::create_directories(dir);
+    }
+
+    std::ofstream outfile(file_path);
+    if (!outfile.is_open())
+    {
+        std::cerr << "Error: Could not open file " << file_path << " for writing." << std::endl;
+        return;
+    }
+
+    outfile << "Test Parameters:" << std::endl;
+    outfile << "r1: " << params.r1 << std::endl;
+    outfile << "r2: " << params.r2 << std::endl;
+    outfile << "h: " << params.h << std::endl;
+    outfile << "cir_res: " << params.cir_res << std::endl;
+    outfile << "cut_angle: " << params.cut_angle << std::endl;
+    outfile << "equidistant: " << (params.equidistant ? "true" : "false") << std::endl;
+    outfile << std::endl;
+
+    outfile << "Outputs:" << std::endl;
+    outfile << "faces: " << F.rows() << ", extent: " << extent << std::endl;
+    outfile << "trig vs projection max diff: " << diff << std::endl;
+    outfile << "max edge length error: trig " << trig_error << ", projection " << proj_error << std::endl;
+    CheckResult(outfile, file_path, "trig and projection within 1e-9 of the extent", diff <= 1e-9 * extent);
+    CheckResult(outfile, file_path, "trig keeps edge lengths", trig_error <= 1e-9);
+    CheckResult(outfile, file_path, "projection keeps edge lengths", proj_error <= 1e-9);
+
+    outfile.close();
+    std::cout << "Test results saved to " << file_path << std::endl;
+}
+
+void run_test_unwrap_placement()
+{
+    constexpr TestParams params1 = {3.0, 1.5, 5.0, 2000, M_PI / 4, 0.0, 0.0, 0.0, true};
+    const std::string file_path1 = "../results/test_UnwrapPlacement_1.txt";
+    test_UnwrapPlacement(file_path1, params1);
+
+    // slivers: very fine steps with a shallow cut, so faces are long and thin
+    constexpr TestParams params2 = {3.0, 1.5, 0.5, 20000, 0.01, 0.0, 0.0, 0.0, false};
+    const std::string file_path2 = "../results/test_UnwrapPlacement_2.txt";
+    test_UnwrapPlacement(file_path2, params2);
+}
+
+// UnwarpCylinder<float> on a row-major mesh into a row-major UV buffer against the double
+// column-major N x 3 result. Float rounding random-walks along the strip, so the bound is
+// 2 sqrt(faces) float epsilons of the strip extent (the error stays at least twice below it
+// from 300 to 70000 faces); the double UV buffer from a row-major mesh must match exactly.
+void test_UnwrapLayout(const std::string& file_path, const TestParams& params)
+{
+    Eigen::MatrixXd V, P, Vuv;
+    Eigen::MatrixXi F;
+    std::vector<int> edges, corrs;
+    CreateCylinderWithCut(params.r1, params.r2, params.h, V, F, P, params.cir_res, params.cut_angle, params.equidistant,
+                          edges, corrs);
+    UnwarpCylinder(V, F, Vuv);
+    const MeshVertices<float> Vrowf = V.cast<float>();
+    const MeshVertices<double> Vrow = V;
+    const MeshFaces Frow = F;
+    UVBuffer<float> uvf;
+    UVBuffer<double> uv;
+    UnwarpCylinder<float>(Vrowf, Frow, uvf);
+    UnwarpCylinder<double>(Vrow, Frow, uv);
+
+    const double extent = (Vuv.colwise().maxCoeff() - Vuv.colwise().minCoeff()).norm();
+    const double bound = 2 * sqrt((double)F.rows()) * std::numeric_limits<float>::epsilon() * extent;
+    const double float_diff = (uvf.cast<double>() - Vuv.leftCols<2>()).cwiseAbs().maxCoeff();
+    const double double_diff = (uv - Vuv.leftCols<2>()).cwiseAbs().maxCoeff();
+
+    std::filesystem::path dir = file_path.substr(0, file_path.find_last_of('/'));
+    if (!std::filesystem::exists(dir))
+    {
+        std::filesystem::create_directories(dir);
+    }
+
+    std::ofstream outfile(file_path);
+    if (!outfile.is_open())
+    {
+        std::cerr << "Error: Could not open file " << file_path << " for writing." << std::endl;
+        return;
+    }
+
+    outfile << "Test Parameters:" << std::endl;
+    outfile << "r1: " << params.r1 << std::endl;
+    outfile << "r2: " << params.r2 << std::endl;
+    outfile << "h: " << params.h << std::endl;
+    outfile << "cir_res: " << params.cir_res << std::endl;
+    outfile << "cut_angle: " << params.cut_angle << std::endl;
+    outfile << "equidistant: " << (params.equidistant ? "true" : "false") << std::endl;
+    outfile << std::endl;
+
+    outfile << "Outputs:" << std::endl;
+    outfile << "faces: " << F.rows() << ", extent: " << extent << ", float bound: " << bound << std::endl;
+    outfile << "float row-major max diff: " << float_diff << std::endl;
+    outfile << "double row-major max diff: " << double_diff << std::endl;
+    CheckResult(outfile, file_path, "float row-major within the bound", float_diff <= bound);
+    CheckResult(outfile, file_path, "double row-major identical", double_diff == 0);
+
+    outfile.close();
+    std::cout << "Test results saved to " << file_path << std::endl;
+}
+
+void run_test_unwrap_layout()
+{
+    constexpr TestParams params1 = {3.0, 1.5, 5.0, 100, M_PI / 4, 0.0, 0.0, 0.0, true};
+    const std::string file_path1 = "../results/test_UnwrapLayout_1.txt";
+    test_UnwrapLayout(file_path1, params1);
+
+    constexpr TestParams params2 = {3.0, 1.5, 5.0, 20000, M_PI / 4, 0.0, 0.0, 0.0, false};
+    const std::string file_path2 = "../results/test_UnwrapLayout_2.txt";
+    test_UnwrapLayout(file_path2, params2);
+}
+
+// SampleOnSpiralBatch against SampleOnSpiral<Equidistant>, in units of double epsilon of the
+// radius (x, z) and of h (ch, the clamped height): spans of every length up to three vectors and
+// one more, at odd offsets, so the padded tail of the vector loop runs for every remainder, and
+// thetas up to the largest spiral range (the 1M-sample budget at circle_res 16, about 4e5 rad).
+// The vectorized kernels (THROAT_UNWRAP_SIMD) must stay within 8 epsilons and give a theta the
+// same result wherever it is in the span; the scalar build must be bit-identical.
+void test_SampleOnSpiralBatch(const std::string& file_path, const TestParams& params)
+{
+    const SpiralParams spiral(params.r1, params.r2, params.h, params.cut_angle, params.equidistant);
+    const int lanes = SpiralBatchLanes();
+    const double theta_max = -2 * M_PI + 1000000 * 2 * M_PI / 16;
+    std::vector<double> theta;
+    for (int i = 0; i < 4000; i++)
+        theta.push_back(-2 * M_PI + i * 0.01); // the start of the spiral, where ch is clamped to 0
+    for (int i = 0; i < 4001; i++)
+        theta.push_back(theta_max - i * 97.3); // down from the largest range
+    const int n = (int)theta.size();
+    std::vector<double> x(n), y(n), z(n), ch(n), cr(n);
+    SampleOnSpiralBatch(spiral, theta, x, y, z, ch, cr);
+
+    double max_error = 0;
+    bool identical = true;
+    for (int i = 0; i < n; i++)
+    {
+        double sch, scr;
+        Eigen::Vector3d p = params.equidistant ? SampleOnSpiral<true>(spiral, theta[i], sch, scr)
+                                               : SampleOnSpiral<false>(spiral, theta[i], sch, scr);
+        const double eps = std::numeric_limits<double>::epsilon();
+        max_error = std::max({max_error, std::abs(x[i] - p.x()) / (eps * scr), std::abs(z[i] - p.z()) / (eps * scr),
+                              std::abs(y[i] - p.y()) / (eps * spiral.h), std::abs(ch[i] - sch) / (eps * spiral.h),
+                              std::abs(cr[i] - scr) / (eps * scr)});
+        identical = identical && x[i] == p.x() && y[i] == p.y() && z[i] == p.z() && ch[i] == sch && cr[i] == scr;
+    }
+
+    // every span length from 1 to 3 * lanes + 1 at offsets that are not multiples of the lanes
+    bool position_independent = true;
+    std::vector<double> sx(n), sy(n), sz(n), sch(n), scr(n);
+    for (int len = 1; len <= 3 * lanes + 1; len++)
+    {
+        for (int offset = 1; offset + len <= n; offset += 997)
+        {
+            std::span<const double> t(theta.data() + offset, len);
+            SampleOnSpiralBatch(spiral, t, std::span<double>(sx.data(), len), std::span<double>(sy.data(), len),
+                                std::span<double>(sz.data(), len), std::span<double>(sch.data(), len),
+                                std::span<double>(scr.data(), len));
+            for (int k = 0; k < len; k++)
+                position_independent = position_independent && sx[k] == x[offset + k] && sy[k] == y[offset + k] &&
+                    sz[k] == z[offset + k] && sch[k] == ch[offset + k] && scr[k] == cr[offset + k];
+        }
+    }
+
+    std::filesystem::path dir = file_path.substr(0, file_path.find_last_of('/'));
+    if (!std::filesystem::exists(dir))
+    {
+        std::filesystem::create_directories(dir);
+    }
+
+    std::ofstream outfile(file_path);
+    if (!outfile.is_open())
+    {
+        std::cerr << "Error: Could not open file " << file_path << " for writing." << std::endl;
+        return;
+    }
+
+    outfile << "Test Parameters:" << std::endl;
+    outfile << "r1: " << params.r1 << std::endl;
+    outfile << "r2: " << params.r2 << std::endl;
+    outfile << "h: " << params.h << std::endl;
+    outfile << "cut_angle: " << params.cut_angle << std::endl;
+    outfile << "equidistant: " << (params.equidistant ? "true" : "false") << std::endl;
+    outfile << "largest theta: " << theta_max << std::endl;
+    outfile << std::endl;
+
+    outfile << "Outputs:" << std::endl;
+    outfile << "thetas: " << n << std::endl;
+    outfile << "max error (epsilons): " << max_error << std::endl;
+    CheckResult(outfile, file_path, "within 8 epsilons of SampleOnSpiral", max_error <= 8);
+    CheckResult(outfile, file_path, "scalar build bit-identical", lanes > 1 || identical);
+    CheckResult(outfile, file_path, "same result at any position in the span", position_independent);
+
+    outfile.close();
+    std::cout << "Test results saved to " << file_path << " (" << lanes << " lanes)" << std::endl;
+}
+
+void run_test_sample_batch()
+{
+    constexpr TestParams params1 = {3.0, 1.5, 500.0, 100, 0.3, 0.0, 0.0, 0.0, false};
+    const std::string file_path1 = "../results/test_SampleOnSpiralBatch_1.txt";
+    test_SampleOnSpiralBatch(file_path1, params1);
+
+    constexpr TestParams params2 = {3.0, 1.5, 500.0, 100, 0.3, 0.0, 0.0, 0.0, true};
+    const std::string file_path2 = "../results/test_SampleOnSpiralBatch_2.txt";
+    test_SampleOnSpiralBatch(file_path2, params2);
+}
+
+// BENCHMARK FUNCTIONS ------------------------------------------------
+// Times UnwarpCylinder on growing meshes (up to ~1M faces); ns/face should stay flat
+void run_bench_unwrap_cylinder()
+{
+    for (int res : {1000, 10000, 100000, 400000})
+    {
+        Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> V, P, Vuv;
+        Eigen::Matrix<int, Eigen::Dynamic, Eigen::Dynamic> F;
+        std::vector<int> edges, corrs;
+        CreateCylinderWithCut(3.0, 1.5, 5.0, V, F, P, res, M_PI / 4, false, edges, corrs);
+
+        auto start = std::chrono::steady_clock::now();
+        UnwarpCylinder(V, F, Vuv);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        std::cout << "UnwarpCylinder: " << F.rows() << " faces in " << ms << " ms ("
+            << 1e6 * ms / F.rows() << " ns/face)" << std::endl;
+
+        Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> Vpar;
+        start = std::chrono::steady_clock::now();
+        UnwarpCylinderParallel(V, F, Vpar);
+        ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        std::cout << "UnwarpCylinderParallel (" << std::thread::hardware_concurrency() << " threads): " << ms
+            << " ms (" << 1e6 * ms / F.rows() << " ns/face), max diff " << (Vpar - Vuv).cwiseAbs().maxCoeff()
+            << " cm of extent " << (Vuv.colwise().maxCoeff() - Vuv.colwise().minCoeff()).norm() << " cm" << std::endl;
+
+        start = std::chrono::steady_clock::now();
+        UnwrapConeAnalytic(3.0, 1.5, 5.0, res, V, F, Vuv);
+        ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        std::cout << "UnwrapConeAnalytic: " << V.rows() << " vertices in " << ms << " ms ("
+            << 1e6 * ms / V.rows() << " ns/vertex)" << std::endl;
+    }
+}
+
+// Trig vs projection placement in UnwarpCylinder: time and edge length preservation, on regular
+// meshes and on sliver meshes (very fine steps with a shallow cut, so faces are long and thin)
+void run_bench_unwrap_placement()
+{
+    for (int res : {1000, 100000, 400000})
+    {
+        for (double cut : {M_PI / 4, 0.01})
+        {
+            Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> V, P, Vtrig, Vproj;
+            Eigen::Matrix<int, Eigen::Dynamic, Eigen::Dynamic> F;
+            std::vector<int> edges, corrs;
+            CreateCylinderWithCut(3.0, 1.5, cut < 0.1 ? 0.5 : 5.0, V, F, P, res, cut, false, edges, corrs);
+
+            auto start = std::chrono::steady_clock::now();
+            UnwarpCylinder(V, F, Vtrig, UnwrapPlacement::Trig);
+            double trig_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+            start = std::chrono::steady_clock::now();
+            UnwarpCylinder(V, F, Vproj, UnwrapPlacement::Projection);
+            double proj_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+            std::cout << "cir_res " << res << " cut_angle " << cut << ": " << F.rows() << " faces, trig " << trig_ms
+                << " ms, projection " << proj_ms << " ms (" << trig_ms / proj_ms << "x); max edge length error trig "
+                << MaxEdgeLengthError(V, F, Vtrig) << ", projection " << MaxEdgeLengthError(V, F, Vproj)
+                << "; max diff " << (Vtrig - Vproj).cwiseAbs().maxCoeff() << " cm" << std::endl;
+        }
+    }
+}
+
+// UnwarpCylinder storage variants: N x 3 column-major double (original API) vs the N x 2 UV
+// buffer from column-major or row-major meshes, in double and float; time, UV bytes and max
+// deviation from the original
+void run_bench_unwrap_layout()
+{
+    for (int res : {1000, 100000, 400000})
+    {
+        Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> V, P, Vuv;
+        Eigen::Matrix<int, Eigen::Dynamic, Eigen::Dynamic> F;
+        std::vector<int> edges, corrs;
+        CreateCylinderWithCut(3.0, 1.5, 5.0, V, F, P, res, M_PI / 4, false, edges, corrs);
+        MeshVertices<double> Vrow = V;
+        MeshVertices<float> Vrowf = V.cast<float>();
+        MeshFaces Frow = F;
+
+        auto start = std::chrono::steady_clock::now();
+        UnwarpCylinder(V, F, Vuv);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "cir_res " << res << ", " << F.rows() << " faces: N x 3 double " << ms << " ms, "
+            << Vuv.size() * sizeof(double) / 1024 << " KiB" << std::endl;
+
+        auto report = [&](const char* name, auto& uv, double ms)
+        {
+            double max_diff = (uv.template cast<double>() - Vuv.leftCols<2>()).cwiseAbs().maxCoeff();
+            std::cout << "    " << name << " " << ms << " ms, " << uv.size() * sizeof(uv(0, 0)) / 1024 << " KiB, max diff "
+                << max_diff << " cm" << std::endl;
+        };
+
+        UVBuffer<double> uv;
+        start = std::chrono::steady_clock::now();
+        UnwarpCylinder<double>(V, F, uv);
+        report("UV double, column-major mesh", uv, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+
+        start = std::chrono::steady_clock::now();
+        UnwarpCylinder<double>(Vrow, Frow, uv);
+        report("UV double, row-major mesh   ", uv, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+
+        UVBuffer<float> uvf;
+        start = std::chrono::steady_clock::now();
+        UnwarpCylinder<float>(Vrowf, Frow, uvf);
+        report("UV float, row-major mesh    ", uvf, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+}
+
+// Full CreateCylinderWithCut + UnwarpCylinder vs StreamCylinderWithCut: total time, time until
+// the first unfolded segments are available, and the memory each holds for the mesh
+void run_bench_stream()
+{
+    for (int res : {1000, 100000, 400000})
+    {
+        const SpiralParams spiral(3.0, 1.5, 5.0, M_PI / 4, false);
+        Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> V, P, Vuv;
+        Eigen::Matrix<int, Eigen::Dynamic, Eigen::Dynamic> F;
+        std::vector<int> edges, corrs;
+
+        auto start = std::chrono::steady_clock::now();
+        CreateCylinderWithCut(spiral, V, F, P, res, edges, corrs);
+        UnwarpCylinder(V, F, Vuv);
+        double full_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        size_t full_bytes = (V.size() + P.size() + Vuv.size()) * sizeof(double) + (F.size() + edges.size()) * sizeof(int);
+
+        size_t nsegments = 0, chunk_bytes = 0;
+        double first_ms = -1;
+        start = std::chrono::steady_clock::now();
+        StreamCylinderWithCut(spiral, res, 4096, [&](const StripChunk& chunk)
+        {
+            if (first_ms < 0)
+                first_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            nsegments += chunk.segments.size() / 4;
+            chunk_bytes = std::max(chunk_bytes, (chunk.uv.size() + chunk.segments.size()) * sizeof(double));
+        });
+        double stream_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        std::cout << "cir_res " << res << ": full " << full_ms << " ms, " << full_bytes / 1024 << " KiB; stream "
+            << stream_ms << " ms, first chunk after " << first_ms << " ms, " << chunk_bytes / 1024
+            << " KiB per chunk, " << nsegments << " segments (" << edges.size() / 2 << " edges)" << std::endl;
+    }
+}
+
+// Per-stage chunk and step counts, busy/wait time and step throughput of a pipelined run
+void PrintStageStats(const std::array<PipelineStageStats, 3>& stats, std::ostream& out = std::cout)
+{
+    for (const PipelineStageStats& st : stats)
+    {
+        out << "  " << st.name << ": " << st.chunks << " chunks, " << st.steps << " steps, busy "
+            << st.busy_ms << " ms, waiting " << st.wait_ms << " ms, "
+            << (st.busy_ms > 0 ? st.steps / st.busy_ms * 1000 : 0) << " steps/s" << std::endl;
+    }
+}
+
+// StreamCylinderWithCut vs StreamCylinderWithCutPipelined writing PostScript segments to a file,
+// with the throughput of each pipeline stage
+void run_bench_pipeline()
+{
+    for (int res : {1000, 100000, 400000})
+    {
+        const SpiralParams spiral(3.0, 1.5, 5.0, M_PI / 4, false);
+        std::array<PipelineStageStats, 3> stats;
+        double ms[2];
+        for (int pipelined = 0; pipelined < 2; pipelined++)
+        {
+            PostScriptWriter out((std::filesystem::temp_directory_path() / "bench_pipeline.ps").string(), 595, 842);
+            auto sink = [&](const StripChunk& chunk)
+            {
+                for (size_t i = 0; i < chunk.segments.size(); i += 4)
+                    out.Segment(chunk.segments[i], chunk.segments[i + 1], chunk.segments[i + 2], chunk.segments[i + 3]);
+            };
+            auto start = std::chrono::steady_clock::now();
+            if (pipelined)
+                StreamCylinderWithCutPipelined(spiral, res, 4096, sink, stats);
+            else
+                StreamCylinderWithCut(spiral, res, 4096, sink);
+            ms[pipelined] = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+        std::cout << "cir_res " << res << ": serial " << ms[0] << " ms, pipelined " << ms[1] << " ms ("
+            << std::thread::hardware_concurrency() << " hardware threads)" << std::endl;
+        PrintStageStats(stats);
+    }
+}
+
+// The CLI's former std::ofstream PostScript output vs the PathWriter formats: time and file size
+void run_bench_path_writers()
+{
+    for (int res : {1000, 100000, 400000})
+    {
+        Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> V, P, Vuv;
+        Eigen::Matrix<int, Eigen::Dynamic, Eigen::Dynamic> F;
+        std::vector<int> edges, corrs;
+        CreateCylinderWithCut(SpiralParams(3.0, 1.5, 5.0, M_PI / 4, false), V, F, P, res, edges, corrs);
+        UnwarpCylinder(V, F, Vuv);
+        Vuv *= 10 * 595 / 210.;
+        const std::filesystem::path dir = std::filesystem::temp_directory_path();
+
+        auto start = std::chrono::steady_clock::now();
+        {
+            std::ofstream out(dir / "bench_path_writers_ofstream.ps");
+            for (int i = 0; i < (int)edges.size(); i += 2)
+            {
+                out << Vuv(edges[i], 0) << " " << Vuv(edges[i], 1) << " moveto\n";
+                out << Vuv(edges[i + 1], 0) << " " << Vuv(edges[i + 1], 1) << " lineto\n";
+                out << Vuv(edges[i + 1], 0) << " " << Vuv(edges[i + 1], 1) << " closepath\n";
+            }
+            out << "0 setlinewidth stroke\n";
+            out << "showpage\n";
+        }
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "cir_res " << res << ", " << edges.size() / 2 << " segments: ofstream " << ms << " ms, "
+            << std::filesystem::file_size(dir / "bench_path_writers_ofstream.ps") / 1024 << " KiB";
+
+        for (const char* ext : {".ps", ".pdf", ".svg", ".dxf"})
+        {
+            const std::filesystem::path path = dir / (std::string("bench_path_writers") + ext);
+            start = std::chrono::steady_clock::now();
+            {
+                std::unique_ptr<PathWriter> out = OpenPathWriter(path.string(), GetPageDimensions(PageSize::A4));
+                for (int i = 0; i < (int)edges.size(); i += 2)
+                    out->Segment(Vuv(edges[i], 0), Vuv(edges[i], 1), Vuv(edges[i + 1], 0), Vuv(edges[i + 1], 1));
+            }
+            ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            std::cout << "; " << ext + 1 << " " << ms << " ms, " << std::filesystem::file_size(path) / 1024 << " KiB";
+        }
+        std::cout << std::endl;
+    }
+}
+
+// OptimizePathOrder on the cut lines written as separate segments in generation order (the
+// worst case: every second segment lies on the other chain), with the travel before and after
+void run_bench_path_order()
+{
+    for (int res : {100, 1000, 10000, 40000})
+    {
+        Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> V, P, Vuv;
+        Eigen::Matrix<int, Eigen::Dynamic, Eigen::Dynamic> F;
+        std::vector<int> edges, corrs;
+        CreateCylinderWithCut(SpiralParams(3.0, 1.5, 5.0, M_PI / 4, false), V, F, P, res, edges, corrs);
+        UnwarpCylinder(V, F, Vuv);
+
+        PolylineSet paths;
+        for (int i = 0; i < (int)edges.size(); i += 2)
+        {
+            const double xy[4] = {Vuv(edges[i], 0), Vuv(edges[i], 1), Vuv(edges[i + 1], 0), Vuv(edges[i + 1], 1)};
+            paths.Add(xy);
+        }
+        auto start = std::chrono::steady_clock::now();
+        TravelStats travel = OptimizePathOrder(paths);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "cir_res " << res << ", " << paths.Count() << " segments: travel " << travel.before << " cm before, "
+            << travel.after << " cm after, " << ms << " ms" << std::endl;
+    }
+}
+
+// ClipToTiles on a large horn's cut lines (in cm scaled to points) over a growing number of A4 pages
+void run_bench_tiling()
+{
+    Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> V, P, Vuv;
+    Eigen::Matrix<int, Eigen::Dynamic, Eigen::Dynamic> F;
+    std::vector<int> edges, corrs;
+    CreateCylinderWithCut(SpiralParams(30.0, 20.0, 60.0, M_PI / 4, false), V, F, P, 10000, edges, corrs);
+    UnwarpCylinder(V, F, Vuv);
+    std::vector<int> vertices, starts;
+    BuildPolylines(edges, (int)Vuv.rows(), vertices, starts);
+
+    for (double scale : {1.0, 4.0, 16.0})
+    {
+        PolylineSet paths;
+        std::vector<double> xy;
+        double w = 0, h = 0;
+        const double minx = Vuv.col(0).minCoeff(), miny = Vuv.col(1).minCoeff();
+        for (size_t k = 0; k + 1 < starts.size(); k++)
+        {
+            xy.clear();
+            for (int i = starts[k]; i < starts[k + 1]; i++)
+            {
+                xy.push_back((Vuv(vertices[i], 0) - minx) * 28.35 * scale);
+                xy.push_back((Vuv(vertices[i], 1) - miny) * 28.35 * scale);
+                w = std::max(w, xy[xy.size() - 2]);
+                h = std::max(h, xy.back());
+            }
+            paths.Add(xy);
+        }
+        TileGrid grid = PlanTiles(w, h, GetPageDimensions(PageSize::A4));
+        std::vector<PolylineSet> tiles;
+        auto start = std::chrono::steady_clock::now();
+        ClipToTiles(paths, grid, tiles);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        size_t pieces = 0;
+        for (const PolylineSet& tile : tiles)
+            pieces += tile.Count();
+        std::cout << "scale " << scale << ": " << paths.xy.size() / 2 << " points on " << grid.cols << "x" << grid.rows
+            << " pages, " << pieces << " clipped polylines, " << ms << " ms" << std::endl;
+    }
+}
+
+// NestOnSheets on growing orders of horn templates in a few sizes (cut lines in cm scaled to points) on A4
+void run_bench_nesting()
+{
+    const double sizes[3][4] = {{12, 8, 6, 45}, {16, 10, 8, 40}, {20, 14, 5, 50}};
+    std::vector<PolylineSet> shapes(3);
+    for (int t = 0; t < 3; t++)
+    {
+        Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> V, P, Vuv;
+        Eigen::Matrix<int, Eigen::Dynamic, Eigen::Dynamic> F;
+        std::vector<int> edges, corrs;
+        const double* s = sizes[t];
+        CreateCylinderWithCut(SpiralParams(s[0] / (2 * M_PI), s[1] / (2 * M_PI), s[2], s[3] / 180 * M_PI, false), V, F,
+                              P, 500, edges, corrs);
+        UnwarpCylinder(V, F, Vuv);
+        std::vector<int> vertices, starts;
+        BuildPolylines(edges, (int)Vuv.rows(), vertices, starts);
+        for (size_t k = 0; k + 1 < starts.size(); k++)
+        {
+            shapes[t].NewPolyline();
+            for (int i = starts[k]; i < starts[k + 1]; i++)
+                shapes[t].Append(Vuv(vertices[i], 0) * 28.35, Vuv(vertices[i], 1) * 28.35);
+        }
+    }
+
+    const PageDimensions page = GetPageDimensions(PageSize::A4);
+    for (int n : {6, 30, 120})
+    {
+        std::vector<NestItem> items(n);
+        for (int i = 0; i < n; i++)
+        {
+            items[i].paths = shapes[i % 3];
+            items[i].shape = i % 3;
+        }
+        auto start = std::chrono::steady_clock::now();
+        NestResult nest = NestOnSheets(items, page.width_pt, page.height_pt);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::cout << n << " templates: " << nest.sheets << " sheets, " << 100 * nest.total_hull_coverage
+            << "% hull coverage, " << ms << " ms" << std::endl;
+    }
+}
+
+// SimplifyPolylines on a long horn's cut lines (cm scaled to points) at cutter-sized tolerances
+void run_bench_simplify()
+{
+    for (int res : {500, 5000})
+    {
+        Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> V, P, Vuv;
+        Eigen::Matrix<int, Eigen::Dynamic, Eigen::Dynamic> F;
+        std::vector<int> edges, corrs;
+        CreateCylinderWithCut(SpiralParams(30.0, 20.0, 60.0, M_PI / 4, false), V, F, P, res, edges, corrs);
+        UnwarpCylinder(V, F, Vuv);
+        std::vector<int> vertices, starts;
+        BuildPolylines(edges, (int)Vuv.rows(), vertices, starts);
+        PolylineSet paths;
+        for (size_t k = 0; k + 1 < starts.size(); k++)
+        {
+            paths.NewPolyline();
+            for (int i = starts[k]; i < starts[k + 1]; i++)
+                paths.Append(Vuv(vertices[i], 0) * 28.35, Vuv(vertices[i], 1) * 28.35);
+        }
+
+        for (double mm : {0.01, 0.05, 0.2})
+        {
+            PolylineSet simplified = paths;
+            auto start = std::chrono::steady_clock::now();
+            int removed = SimplifyPolylines(simplified, mm * 2.835);
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            std::cout << "cir_res " << res << ", " << mm << " mm: " << paths.xy.size() / 2 << " points, "
+                << removed << " removed, " << ms << " ms" << std::endl;
+        }
+    }
+}
+
+// Polyline vs fitted cubic Bezier cut lines (0.05 mm) of a small horn: fit time and PS/PDF/SVG sizes
+void run_bench_bezier()
+{
+    for (int res : {500, 5000, 50000})
+    {
+        Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> V, P, Vuv;
+        Eigen::Matrix<int, Eigen::Dynamic, Eigen::Dynamic> F;
+        std::vector<int> edges, corrs;
+        CreateCylinderWithCut(SpiralParams(3.0, 1.5, 5.0, M_PI / 4, false), V, F, P, res, edges, corrs);
+        UnwarpCylinder(V, F, Vuv);
+        Vuv *= 10 * 595 / 210.;
+        std::vector<int> vertices, starts;
+        BuildPolylines(edges, (int)Vuv.rows(), vertices, starts);
+        PolylineSet paths;
+        for (size_t k = 0; k + 1 < starts.size(); k++)
+        {
+            paths.NewPolyline();
+            for (int i = starts[k]; i < starts[k + 1]; i++)
+                paths.Append(Vuv(vertices[i], 0), Vuv(vertices[i], 1));
+        }
+
+        std::vector<std::vector<double>> fitted(paths.Count());
+        int curves = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int k = 0; k < paths.Count(); k++)
+            curves += FitCubicBeziers(paths[k], 0.05 * 595 / 210., fitted[k]);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "cir_res " << res << ": " << paths.xy.size() / 2 << " points, " << curves << " curves in " << ms
+            << " ms";
+
+        const std::filesystem::path dir = std::filesystem::temp_directory_path();
+        for (const char* ext : {".ps", ".pdf", ".svg"})
+        {
+            const std::filesystem::path lines = dir / (std::string("bench_bezier_lines") + ext);
+            const std::filesystem::path beziers = dir / (std::string("bench_bezier_curves") + ext);
+            {
+                std::unique_ptr<PathWriter> out = OpenPathWriter(lines.string(), GetPageDimensions(PageSize::A4));
+                for (int k = 0; k < paths.Count(); k++)
+                    out->Polyline(paths[k]);
+            }
+            {
+                std::unique_ptr<PathWriter> out = OpenPathWriter(beziers.string(), GetPageDimensions(PageSize::A4));
+                for (const std::vector<double>& curve : fitted)
+                    out->Bezier(curve);
+            }
+            std::cout << "; " << ext + 1 << " " << std::filesystem::file_size(lines) << " -> "
+                << std::filesystem::file_size(beziers) << " bytes";
+        }
+        std::cout << std::endl;
+    }
+}
+
+// Times CreateCylinderWithCut at increasing resolutions
+void run_bench_create_cylinder()
+{
+    for (int res : {500, 5000, 50000, 400000})
+    {
+        Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> V, P;
+        Eigen::Matrix<int, Eigen::Dynamic, Eigen::Dynamic> F;
+        std::vector<int> edges, corrs;
+
+        auto start = std::chrono::steady_clock::now();
+        CreateCylinderWithCut(3.0, 1.5, 5.0, V, F, P, res, M_PI / 4, false, edges, corrs);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        std::cout << "CreateCylinderWithCut: " << V.rows() << " vertices in " << ms << " ms ("
+            << 1e6 * ms / V.rows() << " ns/vertex)" << std::endl;
+    }
+}
+
+// Scalar SampleOnSpiral vs SampleOnSpiralBatch over 1M thetas (about 160 turns at cir_res 500)
+void run_bench_sample_on_spiral()
+{
+    const int n = 1000000;
+    std::vector<double> theta(n), x(n), y(n), z(n), ch(n), cr(n);
+    for (int i = 0; i < n; i++)
+        theta[i] = -2 * M_PI + i * 2 * M_PI / 500;
+
+    for (bool equi : {false, true})
+    {
+        std::vector<Eigen::Vector3d> ref(n);
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < n; i++)
+        {
+            double sch, scr;
+            ref[i] = SampleOnSpiral(3.0, 1.5, 500.0, 0.3, theta[i], sch, scr, equi);
+        }
+        double scalar_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        // hoisted constants, mode resolved once
+        const SpiralParams spiral(3.0, 1.5, 500.0, 0.3, equi);
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < n; i++)
+            z[i] = SampleOnSpiral(spiral, theta[i], ch[i], cr[i]).z();
+        double params_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        start = std::chrono::steady_clock::now();
+        SampleOnSpiralBatch(spiral, theta, x, y, z, ch, cr);
+        double batch_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        double max_diff = 0;
+        for (int i = 0; i < n; i++)
+            max_diff = std::max(max_diff, (ref[i] - Eigen::Vector3d(x[i], y[i], z[i])).cwiseAbs().maxCoeff());
+
+        std::cout << "SampleOnSpiral" << (equi ? " (equidistant)" : "") << ": scalar " << scalar_ms
+            << " ms, SpiralParams " << params_ms << " ms, batch x" << SpiralBatchLanes() << " " << batch_ms << " ms (" << scalar_ms / batch_ms
+            << "x), max diff " << max_diff << std::endl;
+    }
+}
+
+// Direct vs recurrence spiral sampling in CreateCylinderWithCut: time and max vertex deviation
+void run_bench_spiral_recurrence()
+{
+    for (int res : {500, 2000, 20000, 400000})
+    {
+        for (bool equi : {false, true})
+        {
+            const SpiralParams spiral(3.0, 1.5, equi ? 50.0 : 5.0, M_PI / 4, equi);
+            Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> V, Vrec, P;
+            Eigen::Matrix<int, Eigen::Dynamic, Eigen::Dynamic> F;
+            std::vector<int> edges, corrs;
+
+            auto start = std::chrono::steady_clock::now();
+            CreateCylinderWithCut(spiral, V, F, P, res, edges, corrs, SpiralSampling::Direct);
+            double direct_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+            edges.clear();
+            start = std::chrono::steady_clock::now();
+            CreateCylinderWithCut(spiral, Vrec, F, P, res, edges, corrs, SpiralSampling::Recurrence);
+            double rec_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+            std::cout << "cir_res " << res << (equi ? " equidistant" : "") << ": " << V.rows() << " vertices, direct "
+                << direct_ms << " ms, recurrence " << rec_ms << " ms (" << direct_ms / rec_ms << "x), max deviation "
+                << (V - Vrec).cwiseAbs().maxCoeff() << " cm" << std::endl;
+        }
+    }
+}
+
+// Adaptive (chord tolerance) vs uniform (cir_res) sampling: faces, measured chord deviation and
+// UnwarpCylinder time of each
+void run_bench_adaptive_sampling()
+{
+    const SpiralParams spiral(3.0, 1.5, 5.0, M_PI / 4, false);
+    for (double tol : {0.1, 0.01, 0.001})
+    {
+        Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> V, P, Vuv;
+        Eigen::Matrix<int, Eigen::Dynamic, Eigen::Dynamic> F;
+        std::vector<int> edges;
+        std::vector<double> step_theta;
+
+        CreateCylinderWithCutAdaptive(spiral, tol, V, F, P, edges, step_theta);
+        auto start = std::chrono::steady_clock::now();
+        UnwarpCylinder(V, F, Vuv);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        std::cout << "adaptive tol " << tol << " cm: " << F.rows() << " faces, max chord deviation "
+            << MaxChordDeviation(spiral, step_theta, F.rows() / 2 + 1) << " cm, unwrap " << ms << " ms" << std::endl;
+    }
+    for (int res : {50, 200, 1000, 5000})
+    {
+        Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> V, P, Vuv;
+        Eigen::Matrix<int, Eigen::Dynamic, Eigen::Dynamic> F;
+        std::vector<int> edges, corrs;
+
+        CreateCylinderWithCut(spiral, V, F, P, res, edges, corrs);
+        auto start = std::chrono::steady_clock::now();
+        UnwarpCylinder(V, F, Vuv);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        std::vector<double> step_theta(V.rows() / 2);
+        for (int id = 0; id < (int)step_theta.size(); id++)
+            step_theta[id] = -2 * M_PI + id * 2 * M_PI / res;
+        std::cout << "uniform cir_res " << res << ": " << F.rows() << " faces, max chord deviation "
+            << MaxChordDeviation(spiral, step_theta, F.rows() / 2 + 1) << " cm, unwrap " << ms << " ms" << std::endl;
+    }
+}
+
+
+// Main function for testing the app
+// int main(int argc, char* argv[])
+// {
+//     run_test_on_spiral();
+//     run_test_create_cylinder();
+//     run_test_unwrap_cylinder();
+//     run_test_unwrap_cone_analytic();
+//     run_test_create_cylinder_adaptive();
+//     run_test_build_polylines();
+//     run_test_spiral_recurrence();
+//     run_test_stream_pipelined();
+//     run_test_pdf_writer();
+//     run_test_svg_dxf_writer();
+//     run_test_path_order();
+//     run_test_tiling();
+//     run_test_nesting();
+//     run_test_simplify();
+//     run_test_bezier_fit();
+//     run_test_read_batch();
+//     run_test_unwrap_parallel();
+//     run_test_unwrap_shuffled();
+//     run_test_unwrap_placement();
+//     run_test_unwrap_layout();
+//     run_test_sample_batch();
+//     run_test_parse_options();
+//     run_test_batch();
+//     run_bench_create_cylinder();
+//     run_bench_unwrap_cylinder();
+//     run_bench_unwrap_placement();
+//     run_bench_unwrap_layout();
+//     run_bench_stream();
+//     run_bench_pipeline();
+//     run_bench_path_writers();
+//     run_bench_path_order();
+//     run_bench_tiling();
+//     run_bench_nesting();
+//     run_bench_simplify();
+//     run_bench_bezier();
+//     run_bench_batch();
+//     run_bench_sample_on_spiral();
+//     run_bench_spiral_recurrence();
+//     run_bench_adaptive_sampling();
+// }
+
+
+// Generates, unwraps and writes one template with the options set on the command line,
+// reporting to log; false if the output could not be written. Shared by the single-template
+// CLI and -batch, whose threads run it concurrently (it only reads the option globals).
+bool WriteTemplate(const TemplateJob& job, std::ostream& log)
+{
+    const double r1 = job.circumference1 / (2 * M_PI);
+    const double r2 = job.circumference2 / (2 * M_PI);
+    const double h = job.height;
+    const double cut_angle = job.cut_angle / 180 * M_PI;
+    const std::string& outfile = job.outputfile;
+    bool stream = ::stream, pipeline = ::pipeline;
+    Eigen::MatrixXd V, P, Vuv;
+    Eigen::MatrixXi F;
+    std::vector<int> edges, corrs;
+
+    log << "r1: " << r1 << std::endl;
+    log << "r2: " << r2 << std::endl;
+    log << "h: " << h << std::endl;
+    log << "cut_angle: " << cut_angle << std::endl;
+    log << "equidistant: " << equidistant << std::endl;
+    log << "outfile: " << outfile << std::endl;
+
+    if (stream && chord_error > 0)
+    {
+        log << "[WARNING] -stream does not support -chord_error, writing the whole mesh" << std::endl;
+        stream = pipeline = false;
+    }
+    if (stream && optimize_travel)
+    {
+        log << "[WARNING] -optimize_travel needs the whole layout, writing the whole mesh" << std::endl;
+        stream = pipeline = false;
+    }
+    if (stream && !nest_templates.empty())
+    {
+        log << "[WARNING] -nest needs the whole layouts, writing the whole mesh" << std::endl;
+        stream = pipeline = false;
+    }
+
+    // streamed chunks of 4096 steps; the page offset needs the bounding box before the first
+    // line is written, so the strip is generated and unwrapped once for it and once for writing
+    // (the second pass repeats the warnings of the first and is not logged)
+    const SpiralParams spiral(r1, r2, h, cut_angle, equidistant);
+    const int stream_chunk = 4096;
+    std::array<PipelineStageStats, 3> stage_stats;
+    std::ostringstream repeated;
+    int stream_passes = 0;
+    auto run_stream = [&](const std::function<void(const StripChunk&)>& sink)
+    {
+        std::ostream& warnings = stream_passes++ == 0 ? log : repeated;
+        if (pipeline)
+            StreamCylinderWithCutPipelined(spiral, cir_res, stream_chunk, sink, stage_stats, 4,
+                                           UnwrapPlacement::Projection, warnings);
+        else
+            StreamCylinderWithCut(spiral, cir_res, stream_chunk, sink, UnwrapPlacement::Projection, warnings);
+    };
+    double minx, maxx, miny, maxy;
+    if (stream)
+    {
+        minx = miny = INFINITY;
+        maxx = maxy = -INFINITY;
+        run_stream([&](const StripChunk& chunk)
+        {
+            for (size_t i = 0; i < chunk.uv.size(); i += 2)
+            {
+                minx = std::min(minx, chunk.uv[i]);
+                maxx = std::max(maxx, chunk.uv[i]);
+                miny = std::min(miny, chunk.uv[i + 1]);
+                maxy = std::max(maxy, chunk.uv[i + 1]);
+            }
+        });
+    }
+    else
+    {
+        if (chord_error > 0)
+        {
+            std::vector<double> step_theta;
+            CreateCylinderWithCutAdaptive(spiral, chord_error, V, F, P, edges, step_theta, log);
+        }
+        else
+            CreateCylinderWithCut(spiral, V, F, P, cir_res, edges, corrs, SpiralSampling::Direct, log);
+        UnwarpCylinder(V, F, Vuv);
+        minx = Vuv.col(0).minCoeff();
+        maxx = Vuv.col(0).maxCoeff();
+        miny = Vuv.col(1).minCoeff();
+        maxy = Vuv.col(1).maxCoeff();
+    }
+
+    const PageDimensions page = GetPageDimensions(page_size, landscape);
+    double width = page.width_pt;
+    double height = page.height_pt;
+    double cm2pxw = 10 * width / page.width_mm;
+    double cm2pxh = 10 * height / page.height_mm;
+
+    // the cut lines are written as polylines (one path and no pen lift per chain)
+    double offset = 5;
+    auto page_x = [&](double u) { return offset + (u - minx) * cm2pxw; };
+    auto page_y = [&](double v) { return offset + (v - miny) * cm2pxh; };
+
+    // -simplify: each chain is thinned (endpoints kept) before it is laid out or written
+    const double simplify_pt = simplify_tolerance / 10 * std::min(cm2pxw, cm2pxh);
+    long long points_in = 0, points_out = 0;
+    std::vector<double> simplified;
+    auto add_path = [&](PolylineSet& paths, std::span<const double> xy)
+    {
+        points_in += xy.size() / 2;
+        if (simplify_pt > 0)
+        {
+            SimplifyPolyline(xy, simplify_pt, simplified);
+            xy = simplified;
+        }
+        points_out += xy.size() / 2;
+        paths.Add(xy);
+    };
+    auto print_simplified = [&]()
+    {
+        if (simplify_pt > 0)
+            log << "simplify: " << points_in << " cut line points, " << points_out << " kept" << std::endl;
+    };
+    // -bezier: lines of three or more points are written as fitted curves (DXF flattens them)
+    const double bezier_pt = bezier_tolerance / 10 * std::min(cm2pxw, cm2pxh);
+    long long curves = 0, curve_points = 0;
+    std::vector<double> curve;
+    auto write_path = [&](PathWriter& writer, std::span<const double> xy)
+    {
+        if (bezier_pt <= 0 || xy.size() < 6)
+        {
+            writer.Polyline(xy);
+            return;
+        }
+        curves += FitCubicBeziers(xy, bezier_pt, curve);
+        curve_points += xy.size() / 2;
+        writer.Bezier(curve);
+    };
+    auto print_curves = [&]()
+    {
+        if (bezier_pt > 0)
+            log << "bezier: " << curve_points << " cut line points as " << curves << " curves" << std::endl;
+    };
+    auto collect_paths = [&](PolylineSet& paths)
+    {
+        std::vector<int> polyline_vertices, polyline_starts;
+        BuildPolylines(edges, (int)Vuv.rows(), polyline_vertices, polyline_starts);
+        std::vector<double> xy;
+        for (size_t k = 0; k + 1 < polyline_starts.size(); k++)
+        {
+            xy.clear();
+            for (int i = polyline_starts[k]; i < polyline_starts[k + 1]; i++)
+            {
+                xy.push_back(page_x(Vuv(polyline_vertices[i], 0)));
+                xy.push_back(page_y(Vuv(polyline_vertices[i], 1)));
+            }
+            add_path(paths, xy);
+        }
+    };
+    auto order_paths = [&](PolylineSet& paths)
+    {
+        if (!optimize_travel)
+            return;
+        TravelStats travel = OptimizePathOrder(paths);
+        log << "travel: " << travel.before << " pt before, " << travel.after << " pt after ordering" << std::endl;
+    };
+
+    // -nest: this template and the -nest ones packed onto as few sheets as the page size allows,
+    // one page per sheet; identical templates share their rasterized outlines
+    if (!nest_templates.empty())
+    {
+        std::vector<NestItem> items(nest_templates.size() + 1);
+        collect_paths(items[0].paths);
+        items[0].shape = 0;
+        const std::array<double, 4> first = {job.circumference1, job.circumference2, job.height, job.cut_angle};
+        for (size_t t = 0; t < nest_templates.size(); t++)
+        {
+            const std::array<double, 4>& p = nest_templates[t];
+            NestItem& item = items[t + 1];
+            item.shape = (int)t + 1;
+            if (SameTemplate(p, first))
+                item.shape = 0;
+            for (size_t u = 0; u < t && item.shape == (int)t + 1; u++)
+                if (SameTemplate(nest_templates[u], p))
+                    item.shape = items[u + 1].shape;
+
+            Eigen::MatrixXd tV, tP, tVuv;
+            Eigen::MatrixXi tF;
+            std::vector<int> tedges, tcorrs;
+            const SpiralParams params(p[0] / (2 * M_PI), p[1] / (2 * M_PI), p[2], p[3] / 180 * M_PI, equidistant);
+            if (chord_error > 0)
+            {
+                std::vector<double> step_theta;
+                CreateCylinderWithCutAdaptive(params, chord_error, tV, tF, tP, tedges, step_theta, log);
+            }
+            else
+                CreateCylinderWithCut(params, tV, tF, tP, cir_res, tedges, tcorrs, SpiralSampling::Direct, log);
+            UnwarpCylinder(tV, tF, tVuv);
+            std::vector<int> polyline_vertices, polyline_starts;
+            BuildPolylines(tedges, (int)tVuv.rows(), polyline_vertices, polyline_starts);
+            std::vector<double> xy;
+            for (size_t k = 0; k + 1 < polyline_starts.size(); k++)
+            {
+                xy.clear();
+                for (int i = polyline_starts[k]; i < polyline_starts[k + 1]; i++)
+                {
+                    xy.push_back(tVuv(polyline_vertices[i], 0) * cm2pxw);
+                    xy.push_back(tVuv(polyline_vertices[i], 1) * cm2pxh);
+                }
+                add_path(item.paths, xy);
+            }
+        }
+        print_simplified();
+
+        auto start = std::chrono::steady_clock::now();
+        NestResult nest = NestOnSheets(items, width, height, tile_margin, nest_gap * cm2pxw);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        std::unique_ptr<PathWriter> writer = OpenPathWriter(outfile, page, precision);
+        const bool ok = writer->Ok();
+        if (!ok)
+            log << "[ERROR] Cannot open " << outfile << " for writing" << std::endl;
+        for (int s = 0; s < nest.sheets; s++)
+        {
+            PolylineSet sheet;
+            int count = 0;
+            for (size_t i = 0; i < items.size(); i++)
+            {
+                if (nest.placements[i].sheet != s)
+                    continue;
+                PlaceNestItem(items[i].paths, nest.placements[i], sheet);
+                count++;
+            }
+            order_paths(sheet);
+            for (int k = 0; k < sheet.Count(); k++)
+                write_path(*writer, sheet[k]);
+            if (s + 1 < nest.sheets)
+                writer->NewPage();
+            log << "sheet " << s + 1 << ": " << count << " templates, " << 100 * nest.hull_coverage[s]
+                << "% covered by their hulls" << std::endl;
+        }
+        for (size_t i = 0; i < items.size(); i++)
+            if (nest.placements[i].sheet < 0)
+                log << "[WARNING] template " << i + 1 << " does not fit on " << width << "x" << height
+                    << " paper, left out" << std::endl;
+        log << "nesting: " << items.size() << " templates on " << nest.sheets << " sheets, "
+            << 100 * nest.total_hull_coverage << "% covered by template hulls, " << ms << " ms" << std::endl;
+        print_curves();
+        writer->Finish();
+        return ok;
+    }
+
+    // layouts larger than the page are tiled over several pages, from the whole mesh
+    double layout_w = 2 * offset + (maxx - minx) * cm2pxw;
+    double layout_h = 2 * offset + (maxy - miny) * cm2pxh;
+    if ((layout_w > width || layout_h > height) && stream)
+    {
+        log << "[WARNING] tiling needs the whole layout, writing the whole mesh" << std::endl;
+        stream = pipeline = false;
+        CreateCylinderWithCut(spiral, V, F, P, cir_res, edges, corrs, SpiralSampling::Direct, log);
+        UnwarpCylinder(V, F, Vuv);
+    }
+
+    std::unique_ptr<PathWriter> writer = OpenPathWriter(outfile, page, precision);
+    PathWriter& ps = *writer;
+    const bool ok = ps.Ok();
+    if (!ok)
+        log << "[ERROR] Cannot open " << outfile << " for writing" << std::endl;
+
+    if (layout_w > width || layout_h > height)
+    {
+        TileGrid grid = PlanTiles(layout_w, layout_h, page, tile_margin, tile_overlap * cm2pxw);
+        log << "[WARNING] " << layout_w << "x" << layout_h << " pt cutout does not fit on " << width << "x"
+            << height << " paper, tiling it on " << grid.cols << "x" << grid.rows << " pages" << std::endl;
+        PolylineSet paths;
+        collect_paths(paths);
+        std::vector<PolylineSet> tiles;
+        ClipToTiles(paths, grid, tiles);
+
+        // pages in reading order: top row first, left to right
+        for (int r = grid.rows - 1; r >= 0; r--)
+        {
+            for (int c = 0; c < grid.cols; c++)
+            {
+                PolylineSet& tile = tiles[r * grid.cols + c];
+                order_paths(tile);
+                for (int k = 0; k < tile.Count(); k++)
+                    write_path(ps, tile[k]);
+                // marks are printed, not cut: SVG/DXF keep them in their own group / layer
+                PolylineSet marks;
+                AddRegistrationMarks(grid, c, r, marks);
+                for (int k = 0; k < marks.Count(); k++)
+                    ps.Mark(marks[k]);
+                if (r > 0 || c + 1 < grid.cols)
+                    ps.NewPage();
+            }
+        }
+    }
+    else
+    {
+        // the page edge bars are marks, written after the cut lines and never ordered,
+        // simplified or fitted with them
+        const double horizontal_bar[4] = {0, 0, width, 0};
+        const double vertical_bar[4] = {0, 0, 0, height};
+
+        if (stream)
+        {
+            // each joined piece is simplified as it is emitted and keeps its ends; the joiner
+            // cuts chains every 4096 points, so a longer chain keeps a few more points than the
+            // whole-mesh output does (both within the tolerance, see test_SimplifyPolyline)
+            PolylineSet piece;
+            PolylineJoiner joiner([&](std::span<const double> xy)
+            {
+                piece.Clear();
+                add_path(piece, xy);
+                write_path(ps, piece[0]);
+            });
+            run_stream([&](const StripChunk& chunk)
+            {
+                for (size_t i = 0; i < chunk.segments.size(); i += 4)
+                    joiner.Segment(page_x(chunk.segments[i]), page_y(chunk.segments[i + 1]),
+                                   page_x(chunk.segments[i + 2]), page_y(chunk.segments[i + 3]));
+            });
+            joiner.Flush();
+            if (pipeline)
+                PrintStageStats(stage_stats, log);
+        }
+        else
+        {
+            PolylineSet paths;
+            collect_paths(paths);
+            order_paths(paths);
+            for (int k = 0; k < paths.Count(); k++)
+                write_path(ps, paths[k]);
+        }
+        ps.Mark(horizontal_bar);
+        ps.Mark(vertical_bar);
+    }
+    print_simplified();
+    print_curves();
+    ps.Finish();
+    return ok;
+}
+
+// Sets the option globals from argv[first..]
+void ParseOptions(int argc, char* argv[], int first)
+{
+    for (int i = first; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "-equidistant"))
+            equidistant = true;
+        else if (!strcmp(argv[i], "-chord_error") && i + 1 < argc)
+            chord_error = atof(argv[++i]);
+        else if (!strcmp(argv[i], "-stream"))
+            stream = true;
+        else if (!strcmp(argv[i], "-pipeline"))
+            stream = pipeline = true;
+        else if (!strcmp(argv[i], "-precision") && i + 1 < argc)
+            precision = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-page") && i + 1 < argc)
+        {
+            if (!ParsePageSize(argv[++i], page_size))
+                std::cout << "[WARNING] Unknown page size: " << argv[i] << ", using a4" << std::endl;
+        }
+        else if (!strcmp(argv[i], "-landscape"))
+            landscape = true;
+        else if (!strcmp(argv[i], "-optimize_travel"))
+            optimize_travel = true;
+        else if (!strcmp(argv[i], "-overlap") && i + 1 < argc)
+            tile_overlap = atof(argv[++i]);
+        else if (!strcmp(argv[i], "-simplify") && i + 1 < argc)
+            simplify_tolerance = atof(argv[++i]);
+        else if (!strcmp(argv[i], "-bezier") && i + 1 < argc)
+            bezier_tolerance = atof(argv[++i]);
+        else if (!strcmp(argv[i], "-nest") && i + 4 < argc)
+        {
+            nest_templates.push_back({atof(argv[i + 1]), atof(argv[i + 2]), atof(argv[i + 3]), atof(argv[i + 4])});
+            i += 4;
+        }
+        else if (!strcmp(argv[i], "-threads") && i + 1 < argc)
+            batch_threads = std::max(1, atoi(argv[++i]));
+        else if (!strcmp(argv[i], "-manifest") && i + 1 < argc)
+            batch_manifest = argv[++i];
+        else
+            std::cout << "[WARNING] Unknown command: " << argv[i] << std::endl;
+    }
+}
+
+// -batch: one template per row of a CSV or JSONL file (- for stdin), written by a pool of
+// threads; failed rows are reported in the manifest and do not stop the others
+int RunBatchFile(const char* path)
+{
+    std::vector<BatchItem> items;
+    if (!strcmp(path, "-"))
+        items = ReadBatch(std::cin);
+    else
+    {
+        std::ifstream in(path);
+        if (!in)
+        {
+            std::cout << "[ERROR] Cannot open " << path << std::endl;
+            return 1;
+        }
+        items = ReadBatch(in);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<BatchResult> results = RunBatch(items, batch_threads, WriteTemplate);
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    int failed = 0;
+    for (size_t i = 0; i < items.size(); i++)
+    {
+        if (results[i].ok)
+            continue;
+        failed++;
+        std::cout << "line " << items[i].line << " failed: " << results[i].message << std::endl;
+    }
+    if (!WriteManifest(batch_manifest, items, results))
+        std::cout << "[ERROR] Cannot write " << batch_manifest << std::endl;
+    std::cout << "batch: " << items.size() - failed << " of " << items.size() << " templates written, " << failed
+        << " failed, " << ms << " ms on " << batch_threads << " threads; manifest " << batch_manifest << std::endl;
+    return failed > 0 ? 1 : 0;
+}
+
+// ParseOptions on a few argument lists: -equidistant is set only by itself (an inverted strcmp
+// once let any other option turn it on) and option values are consumed with their option.
+// Restores the options it touches.
+void test_ParseOptions(const std::string& file_path)
+{
+    const bool saved_equidistant = equidistant;
+    const double saved_chord_error = chord_error;
+    auto parse = [](std::vector<std::string> args)
+    {
+        equidistant = false;
+        chord_error = 0;
+        std::vector<char*> argv;
+        for (std::string& a : args)
+            argv.push_back(a.data());
+        ParseOptions((int)argv.size(), argv.data(), 0);
+    };
+
+    parse({"-chord_error", "0.01"});
+    bool chord_only = !equidistant && chord_error == 0.01;
+    parse({"-equidistant"});
+    bool equidistant_only = equidistant && chord_error == 0;
+    parse({"-chord_error", "0.02", "-equidistant"});
+    bool both = equidistant && chord_error == 0.02;
+    parse({});
+    bool none = !equidistant && chord_error == 0;
+
+    equidistant = saved_equidistant;
+    chord_error = saved_chord_error;
+
+    std::filesystem::path dir = file_path.substr(0, file_path.find_last_of('/'));
+    if (!std::filesystem::exists(dir))
+    {
+        std::filesystem::create_directories(dir);
+    }
+
+    std::ofstream outfile(file_path);
+    if (!outfile.is_open())
+    {
+        std::cerr << "Error: Could not open file " << file_path << " for writing." << std::endl;
+        return;
+    }
+
+    outfile << "Outputs:" << std::endl;
+    CheckResult(outfile, file_path, "-chord_error 0.01 leaves equidistant off", chord_only);
+    CheckResult(outfile, file_path, "-equidistant sets only equidistant", equidistant_only);
+    CheckResult(outfile, file_path, "-chord_error 0.02 -equidistant sets both", both);
+    CheckResult(outfile, file_path, "no options set nothing", none);
+
+    outfile.close();
+    std::cout << "Test results saved to " << file_path << std::endl;
+}
+
+void run_test_parse_options()
+{
+    test_ParseOptions("../results/test_ParseOptions_1.txt");
+}
+
+// RunBatch with WriteTemplate on two worker threads, writing to the temp directory: two good
+// templates (a one-page PDF and an SVG tiled over several pages), one whose spiral never reaches
+// h (written with one warning), one into a missing directory and one that does not parse. The
+// failures must not stop the others, every item must be in the manifest with its own messages,
+// and nothing may go to std::cout. Run on the whole mesh and with -stream and -pipeline;
+// restores the options it touches.
+void test_RunBatch(const std::string& file_path, bool use_stream, bool use_pipeline)
+{
+    const bool saved_stream = stream, saved_pipeline = pipeline;
+    const std::filesystem::path dir = std::filesystem::temp_directory_path() / "test_RunBatch";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    const std::string good_pdf = (dir / "good.pdf").string(), good_svg = (dir / "good.svg").string();
+    std::stringstream csv;
+    csv << "10,6,4,45," << good_pdf << '\n';
+    csv << "30,30,10,0.0001," << (dir / "truncated.pdf").string() << '\n';
+    csv << "10,6,4,45," << (dir / "missing" / "bad.pdf").string() << '\n';
+    csv << "30,20,ten,45," << (dir / "unparsed.pdf").string() << '\n';
+    csv << "60,40,30,45," << good_svg << '\n';
+    const std::vector<BatchItem> items = ReadBatch(csv);
+
+    stream = use_stream;
+    pipeline = use_pipeline;
+    std::ostringstream console;
+    std::streambuf* saved_cout = std::cout.rdbuf(console.rdbuf());
+    const std::vector<BatchResult> results = RunBatch(items, 2, WriteTemplate);
+    std::cout.rdbuf(saved_cout);
+    stream = saved_stream;
+    pipeline = saved_pipeline;
+
+    const std::string manifest_path = (dir / "manifest.csv").string();
+    const bool manifest_written = WriteManifest(manifest_path, items, results);
+    std::vector<std::string> manifest;
+    std::ifstream manifest_file(manifest_path);
+    for (std::string line; std::getline(manifest_file, line);)
+        manifest.push_back(line);
+
+    auto file_size = [](const std::string& path)
+    {
+        std::error_code error;
+        auto size = std::filesystem::file_size(path, error);
+        return error ? 0 : (long long)size;
+    };
+    const bool statuses = results.size() == 5 && results[0].ok && results[1].ok && !results[2].ok &&
+        !results[3].ok && results[4].ok;
+    const bool files = file_size(good_pdf) > 0 && file_size(good_svg) > 0 &&
+        file_size(PageFilePath(good_svg, 2)) > 0 && file_size((dir / "truncated.pdf").string()) > 0;
+    const bool messages = results.size() == 5 && results[0].message.empty() &&
+        results[1].message.rfind("[WARNING] Spiral never reaches h", 0) == 0 &&
+        results[1].message.find("[WARNING]", 1) == std::string::npos &&
+        results[2].message.rfind("[ERROR] Cannot open", 0) == 0 &&
+        results[3].message == "bad height: 'ten'" &&
+        results[4].message.find("tiling it on") != std::string::npos;
+    bool manifest_rows = manifest_written && manifest.size() == items.size() + 1;
+    for (size_t i = 0; manifest_rows && i < items.size(); i++)
+        manifest_rows = manifest[i + 1].rfind(std::to_string(items[i].line) + "," + items[i].job.outputfile + "," +
+                                              (results[i].ok ? "ok," : "failed,"), 0) == 0;
+    std::filesystem::remove_all(dir);
+
+    std::filesystem::path results_dir = file_path.substr(0, file_path.find_last_of('/'));
+    if (!std::filesystem::exists(results_dir))
+    {
+        std::filesystem::create_directories(results_dir);
+    }
+
+    std::ofstream outfile(file_path);
+    if (!outfile.is_open())
+    {
+        std::cerr << "Error: Could not open file " << file_path << " for writing." << std::endl;
+        return;
+    }
+
+    outfile << "Test Parameters:" << std::endl;
+    outfile << "stream: " << (use_stream ? "true" : "false") << std::endl;
+    outfile << "pipeline: " << (use_pipeline ? "true" : "false") << std::endl;
+    outfile << std::endl;
+
+    outfile << "Outputs:" << std::endl;
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        // paths relative to the temp directory, which differs between machines
+        std::string message = results[i].message;
+        for (size_t at; (at = message.find(dir.string() + "/")) != std::string::npos;)
+            message.erase(at, dir.string().size() + 1);
+        outfile << "line " << items[i].line << ": " << (results[i].ok ? "ok" : "failed") << ", "
+            << std::filesystem::path(items[i].job.outputfile).filename().string() << ", " << message << std::endl;
+    }
+    CheckResult(outfile, file_path, "only the failing items failed", statuses);
+    CheckResult(outfile, file_path, "good templates written", files);
+    CheckResult(outfile, file_path, "each item has its own messages", messages);
+    CheckResult(outfile, file_path, "manifest lists every item", manifest_rows);
+    CheckResult(outfile, file_path, "nothing written to std::cout", console.str().empty());
+
+    outfile.close();
+    std::cout << "Test results saved to " << file_path << std::endl;
+}
+
+void run_test_batch()
+{
+    test_RunBatch("../results/test_RunBatch_1.txt", false, false);
+    test_RunBatch("../results/test_RunBatch_2.txt", true, false);
+    test_RunBatch("../results/test_RunBatch_3.txt", true, true);
+}
+
+// RunBatch on 64 small templates written to the temp directory, on one thread and on one per core
+void run_bench_batch()
+{
+    const std::filesystem::path dir = std::filesystem::temp_directory_path();
+    std::stringstream csv;
+    for (int i = 0; i < 64; i++)
+        csv << 10 + i % 20 << ',' << 6 + i % 5 << ',' << 4 + i % 7 << ",45,"
+            << (dir / ("bench_batch_" + std::to_string(i) + ".pdf")).string() << '\n';
+    std::vector<BatchItem> items = ReadBatch(csv);
+
+    for (int threads : {1, (int)std::max(1u, std::thread::hardware_concurrency())})
+    {
+        auto start = std::chrono::steady_clock::now();
+        std::vector<BatchResult> results = RunBatch(items, threads, WriteTemplate);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        int ok = (int)std::count_if(results.begin(), results.end(), [](const BatchResult& r) { return r.ok; });
+        std::cout << threads << " threads: " << ok << " of " << items.size() << " templates in " << ms << " ms ("
+            << ms / items.size() << " ms each)" << std::endl;
+    }
+}
+
+// Main App
+int main(int argc, char* argv[])
+{
+    if (argc >= 3 && !strcmp(argv[1], "-batch"))
+    {
+        ParseOptions(argc, argv, 3);
+        return RunBatchFile(argv[2]);
+    }
+
+    TemplateJob job{2 * M_PI * r1, 2 * M_PI * r2, h, cut_angle * 180 / M_PI, "test.ps"};
+    if (argc < 6)
+    {
+        std::cout << "Use: " << argv[0] << " circumference1 curcumference2 height cut_angle outputfile " << std::endl;
+        std::cout << "     " << argv[0] << " -batch file.csv|file.jsonl|- [options] -- one template per row (see below)" << std::endl;
+        std::cout << "     -equidistant -- test this flag" << std::endl;
+        std::cout << "     -chord_error <cm> -- sample the spiral adaptively to this max chord deviation" << std::endl;
+        std::cout << "     -stream -- generate, unwrap and write in chunks (bounded memory)" << std::endl;
+        std::cout << "     -pipeline -- like -stream, with each stage on its own thread; prints stage throughput" << std::endl;
+        std::cout << "     -precision <digits> -- decimals of the written coordinates (default 3)" << std::endl;
+        std::cout << "     -page a4|a3|letter|legal -- paper size (default a4)" << std::endl;
+        std::cout << "     -landscape -- landscape orientation" << std::endl;
+        std::cout << "     -optimize_travel -- order the paths for the least plotter/cutter travel (reports it)" << std::endl;
+        std::cout << "     -overlap <cm> -- overlap of the pages when the cutout is tiled (default 1)" << std::endl;
+        std::cout << "     -simplify <mm> -- drop cut line vertices within this distance of the simplified lines (Douglas-Peucker)" << std::endl;
+        std::cout << "     -bezier <mm> -- write the cut lines as smooth cubic curves within this distance" << std::endl;
+        std::cout << "     -nest c1 c2 h angle -- another template to pack onto the same sheets (repeatable); reports the hull coverage" << std::endl;
+        std::cout << "     -threads <n> -- -batch worker threads (default: one per core)" << std::endl;
+        std::cout << "     -manifest <file> -- -batch summary of every row's result (default manifest.csv)" << std::endl;
+        std::cout << "     NOTE: -batch rows are CSV circumference1,circumference2,height,cut_angle,outputfile (an optional" << std::endl;
+        std::cout << "           header may reorder the columns) or JSONL objects with those keys; the options apply to every row" << std::endl;
+        std::cout << "     NOTE: an outputfile ending in .pdf, .svg or .dxf is written in that format (SVG/DXF in mm), anything else as PostScript" << std::endl;
+        std::cout << "     NOTE: all units are centimeters, cut angle is in degrees" << std::endl;
+    }
+    else
+    {
+        job = {atof(argv[1]), atof(argv[2]), atof(argv[3]), atof(argv[4]), argv[5]};
+        ParseOptions(argc, argv, 6);
+    }
+    return WriteTemplate(job, std::cout) ? 0 : 1;
+}